@@ -0,0 +1,830 @@
+/*
+ *  minikernel/HAL.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ */
+
+/*
+ *
+ * Fichero que contiene una implementacin en fuente del mdulo HAL,
+ * equivalente a la proporcionada como objeto binario (HAL.o_32 y
+ * HAL.o_64). Se usa en lugar de sta compilando con "make HAL=fuente".
+ *
+ * El "hardware" se simula con seales de UNIX:
+ *
+ *	SIGFPE			excepcin aritmtica
+ *	SIGSEGV SIGBUS SIGILL	excepcin en acceso a memoria
+ *	SIGALRM			interrupcin de reloj (nivel 3)
+ *	SIGIO			interrupcin de terminal (nivel 2)
+ *	SIGUSR1			llamada al sistema
+ *	SIGUSR2			interrupcin software (nivel 1)
+ *	SIGURG			interrupcin entre procesadores (nivel 3)
+ *
+ * Cada manejador bloquea adems una seal "marca" (SIGPROF, SIGXCPU o
+ * SIGXFSZ) que no se usa para otra cosa y que permite saber, mirando la
+ * mscara, cuntas interrupciones hay anidadas.
+ *
+ * A diferencia del HAL binario, la mscara de seales vigente se lleva
+ * tambin en memoria (mascara_actual), de modo que fijar_nivel_int y el
+ * cambio de contexto solo llaman a sigprocmask cuando la mscara cambia
+ * de verdad, y el cambio de contexto se hace en ensamblador salvando
+ * nicamente los registros que preserva una llamada a funcin.
+ *
+ * Tambin permite simular un multiprocesador (iniciar_UCPs): cada
+ * procesador virtual es un hilo, con su propia mscara de seales,
+ * sus registros y su temporizador de reloj. Un contexto puede
+ * reanudarse en un hilo distinto de aquel en que se suspendi.
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include "HAL.h"
+#include "const.h"
+
+#undef printf
+
+/* Seales que indican que se est tratando una interrupcin */
+#define MARCA_RELOJ SIGPROF
+#define MARCA_TERMINAL SIGXCPU
+#define MARCA_SW SIGXFSZ
+
+/* Seal de la interrupcin entre procesadores */
+#define SENAL_IPI SIGURG
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+/*
+ * Como un contexto puede reanudarse en otro hilo, las funciones que
+ * acceden al estado propio del procesador despus de un cambio de
+ * contexto no se integran en la que las llama: as el compilador no
+ * reutiliza la direccin de las variables del hilo anterior.
+ */
+#define NO_EN_LINEA __attribute__((noinline))
+
+#define TAM_BUF_PRINTK 1024
+#define TAM_NOMBRE_PROG 128
+
+/* Registros generales en que la biblioteca de usuario binaria deja los
+   parmetros de la llamada; los referencia a travs de su variable
+   "reglib". La de fuente los pasa con la propia seal. */
+long registros[NREGS];
+
+/* Directorio del ejecutable del S.O.; lo fija el programa de arranque */
+char *dir_base;
+
+static int nprocs;		/* nmero de imgenes cargadas */
+/* los del HAL binario mas el de la int. entre procesadores (INT_IPI) */
+static void (*tabla_vectores[NVECTORES+1])();
+
+/* Copia de la mscara de seales del procesador y de la que aade
+   cada manejador al activarse */
+static __thread sigset_t mascara_actual;
+static __thread int mascara_conocida;
+static sigset_t mascara_manejador[NSIG];
+
+/* Registros del procesador durante una llamada al sistema */
+static __thread long registros_ucp[NREGS];
+
+/* Nmero de procesador y temporizador de reloj de cada hilo */
+static __thread int ucp_propia;
+static __thread timer_t temporizador;
+static __thread int temporizador_creado;
+
+/* Hilos que hacen de procesadores y rutinas que ejecutan al arrancar
+   un procesador secundario y al arrancar un contexto nuevo */
+static pthread_t *hilos_ucp;
+static int num_ucps=1;
+static void (*man_arranque_ucp)();
+static void (*man_arranque_contexto)();
+
+/* Puntero de pila salvado de un contexto; se guarda en el ucontext */
+#ifdef __x86_64__
+#define PILA_CONTEXTO(c) ((c)->ctxt.uc_mcontext.gregs[REG_RSP])
+#else
+#define PILA_CONTEXTO(c) ((c)->ctxt.uc_mcontext.gregs[REG_ESP])
+#endif
+
+/* Rutinas en ensamblador: conmutar_pila salva los registros que debe
+   preservar una funcin en la pila actual, guarda el puntero de pila en
+   *pila_salvada y retoma la ejecucin en la pila pila_nueva;
+   arranque_contexto es donde empieza un contexto recin creado */
+void conmutar_pila(greg_t *pila_salvada, greg_t pila_nueva)
+		__attribute__((visibility("hidden")));
+void arranque_contexto() __attribute__((visibility("hidden")));
+
+/*
+ *
+ * Funciones auxiliares
+ *
+ */
+
+/* Deja el terminal en modo cannico y con eco */
+static void restaurar_terminal(){
+	struct termios atrib;
+
+	tcgetattr(0, &atrib);
+	atrib.c_lflag |= ICANON;
+	atrib.c_lflag |= ECHO;
+	tcsetattr(0, TCSANOW, &atrib);
+}
+
+/* Lee una vez la mscara real; despus se mantiene la copia */
+static void conocer_mascara(){
+	if (!mascara_conocida) {
+		sigprocmask(SIG_SETMASK, NULL, &mascara_actual);
+		mascara_conocida=1;
+	}
+}
+
+static int mascara_distinta(sigset_t *m){
+	return memcmp(m, &mascara_actual, sizeof(sigset_t))!=0;
+}
+
+/* Fija la mscara real solo si difiere de la vigente */
+static void cambiar_mascara(sigset_t *m){
+	if (mascara_distinta(m)) {
+		mascara_actual=*m;
+		if (sigprocmask(SIG_SETMASK, m, NULL))
+			perror("sigprocmask");
+	}
+}
+
+/*
+ * Al activarse un manejador el procesador aade a la mscara previa
+ * (la que salva en el ucontext) la del manejador y la propia seal. Al
+ * terminar se repone la copia salvada: sigreturn restaura esa mscara.
+ */
+static void entrar_manejador(int sig, void *ctx, sigset_t *previa){
+	ucontext_t *uc=ctx;
+
+	*previa=mascara_actual;
+	sigorset(&mascara_actual, &uc->uc_sigmask, &mascara_manejador[sig]);
+	sigaddset(&mascara_actual, sig);
+}
+
+/* Puede ejecutarse en un hilo distinto del que entr en el manejador */
+static NO_EN_LINEA void salir_manejador(sigset_t *previa){
+	mascara_actual=*previa;
+}
+
+/* Aade a "nueva" las marcas de interrupcin presentes en "actual" */
+static void copiar_marcas(sigset_t *actual, sigset_t *nueva){
+	if (sigismember(actual, MARCA_RELOJ))
+		sigaddset(nueva, MARCA_RELOJ);
+	if (sigismember(actual, MARCA_TERMINAL))
+		sigaddset(nueva, MARCA_TERMINAL);
+	if (sigismember(actual, MARCA_SW))
+		sigaddset(nueva, MARCA_SW);
+}
+
+/*
+ *
+ * Operaciones relacionadas con los dispositivos y las interrupciones.
+ *
+ */
+
+unsigned long long int leer_reloj_CMOS(){
+	struct timeval t;
+
+	gettimeofday(&t, NULL);
+	return (unsigned long long int)t.tv_sec*1000 + t.tv_usec/1000;
+}
+
+/*
+ * Programa el controlador de reloj para que la siguiente interrupcin
+ * llegue dentro de num_ticks ticks. A partir de ella vuelve a
+ * interrumpir peridicamente ticks_por_seg veces por segundo.
+ * Cada procesador tiene su propio temporizador, que solo enva SIGALRM
+ * a su hilo.
+ */
+void programar_cont_reloj(int ticks_por_seg, int num_ticks){
+	struct itimerspec plazos;
+	struct sigevent aviso;
+	long periodo=1000000000/ticks_por_seg;
+	long long primera=(long long)periodo*num_ticks;
+
+	if (!temporizador_creado) {
+		memset(&aviso, 0, sizeof(aviso));
+		aviso.sigev_notify=SIGEV_THREAD_ID;
+		aviso.sigev_signo=SIGALRM;
+		aviso.sigev_notify_thread_id=gettid();
+		if (timer_create(CLOCK_MONOTONIC, &aviso, &temporizador) < 0) {
+			perror("timer_create");
+			exit(1);
+		}
+		temporizador_creado=1;
+	}
+	plazos.it_interval.tv_sec=periodo/1000000000;
+	plazos.it_interval.tv_nsec=periodo%1000000000;
+	plazos.it_value.tv_sec=primera/1000000000;
+	plazos.it_value.tv_nsec=primera%1000000000;
+	timer_settime(temporizador, 0, &plazos, NULL);
+}
+
+void iniciar_cont_reloj(int ticks_por_seg){
+	programar_cont_reloj(ticks_por_seg, 1);
+}
+
+/*
+ * El terminal pasa a modo no cannico y sin eco, y genera SIGIO cuando
+ * hay caracteres disponibles.
+ */
+void iniciar_cont_teclado(){
+	struct termios atrib;
+	int flags;
+
+	if (tcgetattr(0, &atrib) < 0) {
+		perror("Error obteniendo atributos del terminal");
+		exit(1);
+	}
+	atrib.c_lflag &= ~ICANON;
+	atrib.c_lflag &= ~ECHO;
+	atrib.c_cc[VMIN]=1;
+	atrib.c_cc[VTIME]=0;
+	tcsetattr(0, TCSANOW, &atrib);
+
+	if (fcntl(0, F_SETOWN, getpid()) < 0) {
+		perror("fcntl F_SETOWN");
+		exit(1);
+	}
+	if ((flags=fcntl(0, F_GETFL)) < 0) {
+		perror("fcntl F_GETFL");
+		exit(1);
+	}
+	if (fcntl(0, F_SETFL, flags | O_ASYNC) < 0) {
+		perror("fcntl F_SETFL");
+		exit(1);
+	}
+}
+
+/* Excepciones: SIGFPE es aritmtica; el resto, de memoria */
+static void man_exc_preludio(int sig, siginfo_t *info, void *ctx){
+	sigset_t previa;
+
+	entrar_manejador(sig, ctx, &previa);
+	if (sig==SIGFPE)
+		(tabla_vectores[EXC_ARITM])();
+	else
+		(tabla_vectores[EXC_MEM])();
+	salir_manejador(&previa);
+}
+
+/*
+ * Interrupciones de reloj, terminal y entre procesadores. SIGIO puede
+ * llegar sin que haya nada que leer, por lo que se comprueba antes de
+ * invocar al manejador.
+ */
+static void man_int_preludio(int sig, siginfo_t *info, void *ctx){
+	fd_set lectura;
+	struct timeval espera={0, 0};
+	int nivel;
+	int hay_datos;
+	sigset_t previa;
+
+	entrar_manejador(sig, ctx, &previa);
+	if (sig==SIGIO) {
+		FD_ZERO(&lectura);
+		FD_SET(0, &lectura);
+		nivel=fijar_nivel_int(NIVEL_3);
+		hay_datos=select(1, &lectura, NULL, NULL, &espera);
+		fijar_nivel_int(nivel);
+		if (hay_datos > 0)
+			(tabla_vectores[INT_TERMINAL])();
+	}
+	else if (sig==SIGALRM)
+		(tabla_vectores[INT_RELOJ])();
+	else if (sig==SENAL_IPI)
+		(tabla_vectores[INT_IPI])();
+	else
+		panico("INTERRUPCION INESPERADA");
+	salir_manejador(&previa);
+}
+
+static void copiar_registros(long *destino, long *origen){
+	int i;
+
+	for (i=0; i<NREGS; i++)
+		destino[i]=origen[i];
+}
+
+static NO_EN_LINEA void cargar_registros(long *regs){
+	copiar_registros(registros_ucp, regs);
+}
+
+static NO_EN_LINEA void devolver_registros(long *regs){
+	copiar_registros(regs, registros_ucp);
+}
+
+/*
+ * La biblioteca de usuario de fuente pasa la direccin de sus registros
+ * en la seal (sigqueue), por lo que cada procesador tiene los suyos;
+ * la binaria usa "registros", que solo vale con un procesador.
+ */
+static void llam_sis_preludio(int sig, siginfo_t *info, void *ctx){
+	sigset_t previa;
+	long *regs=registros;
+
+	entrar_manejador(sig, ctx, &previa);
+	if (info->si_code==SI_QUEUE)
+		regs=info->si_value.sival_ptr;
+	else if (num_ucps>1)
+		panico("con varios procesadores hace falta la biblioteca de usuario de fuente (make MISC=fuente)");
+	cargar_registros(regs);
+	(tabla_vectores[LLAM_SIS])();
+	devolver_registros(regs);
+	salir_manejador(&previa);
+}
+
+static void int_sw_preludio(int sig, siginfo_t *info, void *ctx){
+	sigset_t previa;
+
+	entrar_manejador(sig, ctx, &previa);
+	(tabla_vectores[INT_SW])();
+	salir_manejador(&previa);
+}
+
+/* Instala el manejador de una seal bloqueando las indicadas en mascara */
+static void instalar_senal(int sig, void (*manej)(int, siginfo_t *, void *),
+				sigset_t *mascara, int flags){
+	struct sigaction act;
+
+	act.sa_sigaction=manej;
+	act.sa_mask=*mascara;
+	act.sa_flags=flags | SA_SIGINFO;
+	mascara_manejador[sig]=*mascara;
+	sigaction(sig, &act, NULL);
+}
+
+void iniciar_cont_int(){
+	sigset_t mascara;
+
+	conocer_mascara();
+
+	sigemptyset(&mascara);
+	sigaddset(&mascara, MARCA_SW);
+	instalar_senal(SIGUSR2, int_sw_preludio, &mascara, 0);
+
+	sigemptyset(&mascara);
+	sigaddset(&mascara, SIGUSR2);
+	sigaddset(&mascara, MARCA_SW);
+	instalar_senal(SIGUSR1, llam_sis_preludio, &mascara, 0);
+
+	sigemptyset(&mascara);
+	sigaddset(&mascara, SIGIO);
+	sigaddset(&mascara, SIGUSR1);
+	sigaddset(&mascara, SIGUSR2);
+	sigaddset(&mascara, SENAL_IPI);
+	sigaddset(&mascara, MARCA_RELOJ);
+	instalar_senal(SIGALRM, man_int_preludio, &mascara, SA_RESTART);
+
+	/* la int. entre procesadores es del nivel del reloj y no se anidan */
+	sigemptyset(&mascara);
+	sigaddset(&mascara, SIGALRM);
+	sigaddset(&mascara, SIGIO);
+	sigaddset(&mascara, SIGUSR1);
+	sigaddset(&mascara, SIGUSR2);
+	sigaddset(&mascara, MARCA_RELOJ);
+	instalar_senal(SENAL_IPI, man_int_preludio, &mascara, SA_RESTART);
+
+	sigemptyset(&mascara);
+	sigaddset(&mascara, SIGUSR1);
+	sigaddset(&mascara, SIGUSR2);
+	sigaddset(&mascara, MARCA_TERMINAL);
+	instalar_senal(SIGIO, man_int_preludio, &mascara, SA_RESTART);
+
+	sigemptyset(&mascara);
+	sigaddset(&mascara, SIGUSR2);
+	instalar_senal(SIGILL, man_exc_preludio, &mascara, 0);
+	instalar_senal(SIGBUS, man_exc_preludio, &mascara, 0);
+	instalar_senal(SIGFPE, man_exc_preludio, &mascara, 0);
+	instalar_senal(SIGSEGV, man_exc_preludio, &mascara, 0);
+}
+
+void instal_man_int(int nvector, void (*manej)()){
+	if (nvector<0 || nvector>INT_IPI)
+		panico("usando un vector no existente");
+	tabla_vectores[nvector]=manej;
+}
+
+/*
+ * Cada nivel enmascara las seales de su interrupcin y las de los
+ * niveles inferiores. El nivel previo se deduce de la mscara anterior.
+ */
+int fijar_nivel_int(int nivel){
+	sigset_t nueva;
+	int previo;
+
+	conocer_mascara();
+	sigemptyset(&nueva);
+	copiar_marcas(&mascara_actual, &nueva);
+
+	switch (nivel) {
+	case NIVEL_3:
+		sigaddset(&nueva, SIGALRM);
+		sigaddset(&nueva, SENAL_IPI);
+	case NIVEL_2:
+		sigaddset(&nueva, SIGIO);
+	case NIVEL_1:
+		sigaddset(&nueva, SIGUSR1);
+		sigaddset(&nueva, SIGUSR2);
+	}
+
+	if (sigismember(&mascara_actual, SIGALRM))
+		previo=NIVEL_3;
+	else if (sigismember(&mascara_actual, SIGIO))
+		previo=NIVEL_2;
+	else
+		previo=NIVEL_1;
+	cambiar_mascara(&nueva);
+	return previo;
+}
+
+/*
+ * Dentro de un manejador est bloqueada su marca (o la propia seal, si
+ * es una excepcin). Si hay ms de una, la interrupcin se produjo
+ * mientras se trataba otra, es decir, en modo sistema.
+ */
+int viene_de_modo_usuario(){
+	sigset_t actual;
+	int anidadas=0;
+
+	conocer_mascara();
+	actual=mascara_actual;
+	if (sigismember(&actual, MARCA_RELOJ))
+		anidadas++;
+	if (sigismember(&actual, MARCA_TERMINAL))
+		anidadas++;
+	if (sigismember(&actual, MARCA_SW))
+		anidadas++;
+	if (sigismember(&actual, SIGILL))
+		anidadas++;
+	if (sigismember(&actual, SIGBUS))
+		anidadas++;
+	if (sigismember(&actual, SIGFPE))
+		anidadas++;
+	if (sigismember(&actual, SIGSEGV))
+		anidadas++;
+	return anidadas<=1;
+}
+
+/* La int. SW es del procesador que la activa */
+void activar_int_SW(){
+	pthread_kill(pthread_self(), SIGUSR2);
+}
+
+/*
+ *
+ * Operacin de salvaguarda y recuperacin de contexto hardware del proceso.
+ *
+ */
+
+/*
+ * Los registros generales no forman parte del ucontext: se guardan
+ * aparte, junto con la mscara de seales
+ */
+static NO_EN_LINEA void salvar_contexto(contexto_t *contexto){
+	copiar_registros(contexto->registros, registros_ucp);
+	contexto->ctxt.uc_sigmask=mascara_actual;
+}
+
+static NO_EN_LINEA void reanudar_contexto(contexto_t *contexto){
+	cambiar_mascara(&contexto->ctxt.uc_sigmask);
+	copiar_registros(registros_ucp, contexto->registros);
+}
+
+/*
+ * Cada contexto guarda su mscara de seales al salir y la repone al
+ * volver, despus de conmutar de pila: entre medias sigue vigente la
+ * del contexto saliente. Como todos los cambios se hacen desde el
+ * ncleo con un nivel similar, normalmente no hace falta sigprocmask.
+ */
+void cambio_contexto(contexto_t *contexto_a_salvar, contexto_t *contexto_a_restaurar){
+	greg_t pila_descartada;
+
+	if (contexto_a_salvar==NULL)
+		conmutar_pila(&pila_descartada, PILA_CONTEXTO(contexto_a_restaurar));
+	else if (contexto_a_salvar!=contexto_a_restaurar) {
+		salvar_contexto(contexto_a_salvar);
+		conmutar_pila(&PILA_CONTEXTO(contexto_a_salvar),
+				PILA_CONTEXTO(contexto_a_restaurar));
+		reanudar_contexto(contexto_a_salvar);
+	}
+}
+
+#if defined(__x86_64__)
+/* Se salvan rbx, rbp y r12-r15, adems de los registros de control de
+   coma flotante (MXCSR y palabra de control de la x87) */
+__asm__(
+	"	.text\n"
+	"	.globl conmutar_pila\n"
+	"	.hidden conmutar_pila\n"
+	"	.type conmutar_pila, @function\n"
+	"conmutar_pila:\n"
+	"	pushq %rbp\n"
+	"	pushq %rbx\n"
+	"	pushq %r12\n"
+	"	pushq %r13\n"
+	"	pushq %r14\n"
+	"	pushq %r15\n"
+	"	subq $8, %rsp\n"
+	"	stmxcsr (%rsp)\n"
+	"	fnstcw 4(%rsp)\n"
+	"	movq %rsp, (%rdi)\n"
+	"	movq %rsi, %rsp\n"
+	"	ldmxcsr (%rsp)\n"
+	"	fldcw 4(%rsp)\n"
+	"	addq $8, %rsp\n"
+	"	popq %r15\n"
+	"	popq %r14\n"
+	"	popq %r13\n"
+	"	popq %r12\n"
+	"	popq %rbx\n"
+	"	popq %rbp\n"
+	"	ret\n"
+	"	.size conmutar_pila, .-conmutar_pila\n"
+	"	.globl arranque_contexto\n"
+	"	.hidden arranque_contexto\n"
+	"	.type arranque_contexto, @function\n"
+	"arranque_contexto:\n"
+	"	movq %r12, %rdi\n"
+	"	movq %r13, %rsi\n"
+	"	call lanzadera\n"
+	"	ud2\n"
+	"	.size arranque_contexto, .-arranque_contexto\n"
+);
+#elif defined(__i386__)
+/* Se salvan ebx, esi, edi y ebp, adems de la palabra de control de la
+   x87 */
+__asm__(
+	"	.text\n"
+	"	.globl conmutar_pila\n"
+	"	.hidden conmutar_pila\n"
+	"	.type conmutar_pila, @function\n"
+	"conmutar_pila:\n"
+	"	movl 4(%esp), %eax\n"
+	"	movl 8(%esp), %edx\n"
+	"	pushl %ebp\n"
+	"	pushl %ebx\n"
+	"	pushl %esi\n"
+	"	pushl %edi\n"
+	"	subl $4, %esp\n"
+	"	fnstcw (%esp)\n"
+	"	movl %esp, (%eax)\n"
+	"	movl %edx, %esp\n"
+	"	fldcw (%esp)\n"
+	"	addl $4, %esp\n"
+	"	popl %edi\n"
+	"	popl %esi\n"
+	"	popl %ebx\n"
+	"	popl %ebp\n"
+	"	ret\n"
+	"	.size conmutar_pila, .-conmutar_pila\n"
+	"	.globl arranque_contexto\n"
+	"	.hidden arranque_contexto\n"
+	"	.type arranque_contexto, @function\n"
+	"arranque_contexto:\n"
+	"	pushl %esi\n"
+	"	pushl %ebx\n"
+	"	call lanzadera\n"
+	"	ud2\n"
+	"	.size arranque_contexto, .-arranque_contexto\n"
+);
+#else
+#error "cambio de contexto no implementado para esta arquitectura"
+#endif
+
+/*
+ *
+ * Operaciones relacionadas con mapa de memoria del proceso y pila
+ *
+ */
+
+/*
+ * Los programas de usuario son bibliotecas dinmicas del directorio
+ * "usuario". Su variable "reglib" se enlaza con los registros del HAL.
+ */
+void * crear_imagen(char *prog, void **dir_ini){
+	char nombre[TAM_NOMBRE_PROG];
+	void *imagen;
+	long **reglib;
+
+	snprintf(nombre, sizeof(nombre), "%s../usuario/%s", dir_base, prog);
+	if ((imagen=dlopen(nombre, RTLD_LAZY))==NULL)
+		return NULL;
+	if ((*dir_ini=dlsym(imagen, "main"))==NULL)
+		return NULL;
+	if ((reglib=dlsym(imagen, "reglib"))==NULL)
+		return NULL;
+	*reglib=registros;
+	nprocs++;
+	return imagen;
+}
+
+void * crear_pila(int tam){
+	return malloc(tam);
+}
+
+/* La pila se reserva con malloc pero no se libera, igual que en el
+   HAL binario: el proceso que termina sigue ejecutando sobre ella */
+void liberar_pila(void *pila){
+}
+
+/* Al terminar el ltimo programa de usuario se apaga el sistema */
+void liberar_imagen(void *mem){
+	dlclose(mem);
+	if (--nprocs==0) {
+		restaurar_terminal();
+		exit(0);
+	}
+}
+
+/*
+ * Primera funcin que ejecuta un proceso: ejecuta la rutina de arranque
+ * de contextos del sistema, si la hay, habilita todas las interrupciones
+ * y llama a la rutina "start" de la biblioteca de usuario, que a su vez
+ * invoca a "main". Se llega desde arranque_contexto con la mscara del
+ * contexto saliente.
+ */
+static void __attribute__((used)) lanzadera(void (*start)(void *), void *pc){
+	sigset_t vacia;
+
+	if (man_arranque_contexto)
+		man_arranque_contexto();
+	sigemptyset(&vacia);
+	cambiar_mascara(&vacia);
+	start(pc);
+}
+
+/*
+ * Prepara en la cima de la pila el marco que espera conmutar_pila: los
+ * registros salvados (con "start" y el pc inicial en dos de ellos, de
+ * donde los toma arranque_contexto) y la direccin de retorno.
+ */
+void fijar_contexto_ini(void *mem, void *p_pila, int tam_pila,
+			void * pc_inicial, contexto_t *contexto_ini){
+	void *start;
+	uintptr_t cima;
+	greg_t *marco;
+
+	if ((start=dlsym(mem, "start"))==NULL)
+		return;
+	cima=((uintptr_t)p_pila+tam_pila) & ~(uintptr_t)15;
+
+#ifdef __x86_64__
+	marco=(greg_t *)cima-8;
+	marco[0]=0x1f80 | (greg_t)0x37f<<32;	/* MXCSR y control x87 */
+	marco[1]=0;				/* r15 */
+	marco[2]=0;				/* r14 */
+	marco[3]=(greg_t)pc_inicial;		/* r13 */
+	marco[4]=(greg_t)start;			/* r12 */
+	marco[5]=0;				/* rbx */
+	marco[6]=0;				/* rbp */
+	marco[7]=(greg_t)arranque_contexto;	/* retorno */
+#else
+	/* se deja hueco para que la pila quede alineada en la llamada */
+	marco=(greg_t *)cima-8;
+	marco[0]=0x37f;				/* control x87 */
+	marco[1]=0;				/* edi */
+	marco[2]=(greg_t)pc_inicial;		/* esi */
+	marco[3]=(greg_t)start;			/* ebx */
+	marco[4]=0;				/* ebp */
+	marco[5]=(greg_t)arranque_contexto;	/* retorno */
+#endif
+	PILA_CONTEXTO(contexto_ini)=(greg_t)marco;
+}
+
+/*
+ *
+ * Operaciones miscelneas
+ *
+ */
+
+long leer_registro(int nreg){
+	if (nreg<0 || nreg>=NREGS)
+		return 0;
+	return registros_ucp[nreg];
+}
+
+int escribir_registro(int nreg, long valor){
+	if (nreg<0 || nreg>=NREGS)
+		return -1;
+	registros_ucp[nreg]=valor;
+	return 0;
+}
+
+char leer_puerto(int dir_puerto){
+	char car=0;
+
+	if (dir_puerto==DIR_TERMINAL)
+		read(0, &car, 1);
+	return car;
+}
+
+void halt(){
+	pause();
+}
+
+void panico(char *mens){
+	fijar_nivel_int(NIVEL_3);
+	write(2, mens, strlen(mens));
+	write(2, "\n", 1);
+	restaurar_terminal();
+	exit(1);
+}
+
+void escribir_ker(char *buffer, unsigned int longi){
+	int nivel;
+
+	nivel=fijar_nivel_int(NIVEL_3);
+	write(1, buffer, longi);
+	fijar_nivel_int(nivel);
+}
+
+int printk(const char *formato, ...){
+	char buf[TAM_BUF_PRINTK];
+	va_list args;
+	int n;
+
+	va_start(args, formato);
+	n=vsnprintf(buf, sizeof(buf), formato, args);
+	va_end(args);
+	if (n > 0)
+		escribir_ker(buf, strlen(buf));
+	return n;
+}
+
+/*
+ *
+ * Operaciones del multiprocesador
+ *
+ */
+
+static void *hilo_ucp(void *arg){
+	ucp_propia=(int)(intptr_t)arg;
+	man_arranque_ucp();
+	panico("procesador secundario parado inesperadamente");
+	return NULL;
+}
+
+/*
+ * El procesador que llama es el 0; cada uno de los dems es un hilo que
+ * empieza ejecutando "arranque" con la mscara del que lo crea, es decir,
+ * con las interrupciones inhibidas si se llama durante el arranque.
+ */
+void iniciar_UCPs(int num, void (*arranque)()){
+	int i;
+
+	if ((hilos_ucp=malloc(num*sizeof(pthread_t)))==NULL)
+		panico("no hay memoria para los procesadores");
+	hilos_ucp[0]=pthread_self();
+	num_ucps=num;
+	man_arranque_ucp=arranque;
+	for (i=1; i<num; i++)
+		if (pthread_create(&hilos_ucp[i], NULL, hilo_ucp, (void *)(intptr_t)i))
+			panico("no se pueden crear los procesadores");
+}
+
+int ucp_actual(){
+	return ucp_propia;
+}
+
+void enviar_IPI(int ucp){
+	if (ucp>=0 && ucp<num_ucps)
+		pthread_kill(hilos_ucp[ucp], SENAL_IPI);
+}
+
+void instal_man_arranque(void (*manej)()){
+	man_arranque_contexto=manej;
+}
+
+/*
+ * Cerrojo de espera activa sobre un intercambio atmico. Con menos
+ * procesadores reales que virtuales, el que espera cede el suyo.
+ */
+void bloquear_cerrojo(cerrojo_t *cerrojo){
+	while (__atomic_exchange_n(cerrojo, 1, __ATOMIC_ACQUIRE))
+		while (__atomic_load_n(cerrojo, __ATOMIC_RELAXED))
+			sched_yield();
+}
+
+void desbloquear_cerrojo(cerrojo_t *cerrojo){
+	__atomic_store_n(cerrojo, 0, __ATOMIC_RELEASE);
+}
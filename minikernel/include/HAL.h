@@ -76,6 +76,11 @@ unsigned long long int leer_reloj_CMOS(); /* obtiene hora del rejoj CMOS */
 
 void iniciar_cont_reloj(int ticks_por_seg); /* iniciar controlador de reloj */
 
+/* programa la siguiente int. de reloj dentro de num_ticks ticks; despues
+   sigue siendo periodica (solo la tiene el HAL de fuente, HAL.c, y el
+   nucleo solo la usa con TICK_DINAMICO) */
+void programar_cont_reloj(int ticks_por_seg, int num_ticks);
+
 void iniciar_cont_teclado(); /* iniciar controlador de teclado */
 
 void iniciar_cont_int();  /* iniciar controlador de interrupciones. */
@@ -142,5 +147,34 @@ void escribir_ker(char *buffer, unsigned int longi); /* escribe en pantalla */
 
 int printk(const char *, ...); /* escribe en pantalla con formato */
 
+/*
+ *
+ * Operaciones del multiprocesador simulado (solo en HAL.c: make HAL=fuente)
+ *
+ */
+
+/* arranca num procesadores: el que llama es el 0 y los dems ejecutan
+   "arranque" con las interrupciones inhibidas */
+void iniciar_UCPs(int num, void (*arranque)());
+
+int ucp_actual(); /* nmero del procesador que ejecuta */
+
+/* vector de la int. entre procesadores: el siguiente a los NVECTORES de
+   const.h, que son los del HAL binario y no cambian */
+#define INT_IPI NVECTORES
+
+void enviar_IPI(int ucp); /* int. entre procesadores al indicado */
+
+/* instala la rutina que ejecuta un contexto nuevo antes de pasar a
+   modo usuario */
+void instal_man_arranque(void (*manej)());
+
+/* cerrojos de espera activa entre procesadores */
+typedef int cerrojo_t;
+
+void bloquear_cerrojo(cerrojo_t *cerrojo);
+
+void desbloquear_cerrojo(cerrojo_t *cerrojo);
+
 
 #endif /* _HAL_H */
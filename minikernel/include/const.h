@@ -22,7 +22,7 @@
 #define NULL (void *) 0		/* por si acaso no esta ya definida */
 #endif
 
-#define MAX_PROC 10		/* dimension de tabla de procesos */
+#define MAX_PROC 4096		/* dimension de tabla de procesos */
 
 #define TAM_PILA 32768
 
@@ -35,6 +35,7 @@
 #define LISTO 1
 #define EJECUCION 2
 #define BLOQUEADO 3
+#define ZOMBI 4		/* Proc. terminado cuyo estado no ha recogido el padre */
 
 /*
  * Niveles de ejecucin del procesador. 
@@ -67,12 +68,32 @@
 /* constante usada en implementacion de round robin */
 #define TICKS_POR_RODAJA 10
 
-/* constantes usada en implementacion de mutex */
+/* constantes usada en implementacion de mutex (se pueden cambiar al
+   compilar, p.ej. make OPCIONES="-DNUM_MUT=1024 -DNUM_MUT_PROC=256") */
+#ifndef NUM_MUT
 #define NUM_MUT 16 /* numero total de mutex en el sistema */
+#endif
+#ifndef NUM_MUT_PROC
 #define NUM_MUT_PROC 4 /* numero maximo de mutex que puede tener
 			  abiertos un proceso */
+#endif
 #define MAX_NOM_MUT 8 /* longitud maxima de un nombre de mutex */
 
+/* constantes usadas en implementacion de rwlocks (cerrojos de lectores
+   y escritores), que se pueden cambiar al compilar como las de mutex.
+   Sus nombres tienen la misma longitud maxima que los de mutex. */
+#ifndef NUM_RW
+#define NUM_RW 16 /* numero total de rwlocks en el sistema */
+#endif
+#ifndef NUM_RW_PROC
+#define NUM_RW_PROC 4 /* numero maximo de rwlocks que puede tener
+			 abiertos un proceso */
+#endif
+
+/* constante usada en la cache de imagenes de programas */
+#define MAX_NOM_PROG 64 /* longitud maxima del nombre de un programa
+			   para guardar su imagen en la cache */
+
 /* constante usada en implementacion de manejador de terminal */
 #define TAM_BUF_TERM 8 /* tamao del buffer del terminal */
 
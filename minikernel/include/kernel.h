@@ -21,15 +21,129 @@
 // Creado por nosotros
 #define NO_RECURSIVO 0
 #define RECURSIVO 1
-// Estados de los mutex
-#define BLOQUEADO_MUTEX 0
-#define DESBLOQUEADO_MUTEX 1
+// A quien se da un rwlock que esperan lectores y escritores
+#define PREFERENCIA_LECTORES 0
+#define PREFERENCIA_ESCRITORES 1
+// Valor de la palabra de un mutex (ver cerrojo_mutex) que tiene ese proceso
+#define CERROJO_DUENO(id) ((unsigned int)(id)+1)
+// Prioridades de los procesos (mayor valor, mayor prioridad)
+#define NUM_PRIORIDADES 32
+#define PRIORIDAD_DEFECTO 15
+// Tramos (potencias de 2 del numero de listos) de las estadisticas
+#define NUM_TRAMOS_LISTOS 12
+// Colas multinivel realimentadas (compilando con -DMLFQ). Usan los
+// NIVELES_MLFQ niveles mas prioritarios; la rodaja se duplica en cada
+// nivel que se desciende y cada PERIODO_IMPULSO_MLFQ ticks todos los
+// procesos vuelven al nivel superior.
+#define NIVELES_MLFQ 4
+#define RODAJA_BASE_MLFQ (TICKS_POR_RODAJA/2)
+#define PERIODO_IMPULSO_MLFQ (2*TICK)
+// Maximo de ticks seguidos sin int. de reloj con tick dinamico
+// (compilando con -DTICK_DINAMICO, que usa el HAL de fuente) cuando no
+// hay ningun plazo pendiente
+#define MAX_TICKS_OMITIDOS (10*TICK)
+// Multiprocesador simulado (compilando con -DSMP, que usa el HAL de
+// fuente): NUM_UCPS procesadores virtuales, cada uno un hilo del sistema
+// anfitrion, con su proceso actual y su cola de listos
+#ifdef SMP
+#ifndef NUM_UCPS
+#define NUM_UCPS 2
+#endif
+#ifdef TICK_DINAMICO
+#error "TICK_DINAMICO no esta disponible con SMP"
+#endif
+#if NUM_UCPS>32
+#error "NUM_UCPS no puede ser mayor que 32 (mascaras de afinidad)"
+#endif
+#else
+#define NUM_UCPS 1
+#endif
+// Codigo de terminacion de un proceso que termina por una excepcion
+#define ESTADO_EXCEPCION (-1)
+// Mascara de afinidad con todos los procesadores
+#define TODAS_UCPS (0xFFFFFFFFU>>(32-NUM_UCPS))
+// Cada PERIODO_EQUILIBRADO ticks el procesador 0 reparte los listos
+// entre los procesadores (con SMP). Con 0 no se reparte: solo roban
+// los procesadores ociosos.
+#ifndef PERIODO_EQUILIBRADO
+#define PERIODO_EQUILIBRADO (TICK/10)
+#endif
+// Cache de pilas: al arrancar se reservan PILAS_INICIALES pilas ya
+// tocadas, que no provocan fallos de pagina al usarlas, y se guardan
+// las de los procesos que terminan, hasta MAX_PILAS_LIBRES, para
+// darselas a los nuevos. Con MAX_PILAS_LIBRES 0 no se usa.
+#ifndef MAX_PILAS_LIBRES
+#define MAX_PILAS_LIBRES 128
+#endif
+#ifndef PILAS_INICIALES
+#define PILAS_INICIALES 16
+#endif
+// Cache de imagenes de programas: hasta MAX_IMAGENES programas cargados
+// a la vez. De los que ya no usa ningun proceso se mantienen hasta
+// MAX_IMAGENES_LIBRES, expulsando el que se uso hace mas tiempo (o, con
+// -DIMAGENES_LFU, el que menos procesos ha tenido). Al arrancar se
+// cargan los programas de IMAGENES_PRECARGADAS (nombres entre comillas
+// separados por comas).
+#ifndef MAX_IMAGENES
+#define MAX_IMAGENES 32
+#endif
+#ifndef MAX_IMAGENES_LIBRES
+#define MAX_IMAGENES_LIBRES 8
+#endif
+#ifndef IMAGENES_PRECARGADAS
+#define IMAGENES_PRECARGADAS "init"
+#endif
+// Liberacion diferida: un proceso o hilo que termina deja pendientes de
+// liberar su pila, su entrada de la tabla y su imagen y cambia de
+// proceso enseguida. Las pendientes se liberan juntas cuando un
+// procesador se queda ocioso, antes de crear procesos o hilos y cuando
+// ya hay mas de MAX_PENDIENTES_LIBERAR. Con 0 se liberan al terminar.
+#ifndef MAX_PENDIENTES_LIBERAR
+#define MAX_PENDIENTES_LIBERAR 64
+#endif
+// Tabla de mutex: el identificador de un mutex es su entrada en la
+// tabla mas NUM_MUT por cada vez que se ha reutilizado esa entrada, de
+// modo que el de un mutex ya destruido no vale para el siguiente que la
+// ocupa. Los nombres se buscan en una tabla hash de TAM_HASH_MUTEX
+// listas y cada proceso tiene un mapa de bits de los que tiene abiertos.
+#ifndef TAM_HASH_MUTEX
+#define TAM_HASH_MUTEX (2*NUM_MUT)
+#endif
+// Deteccion de interbloqueos: antes de bloquearse en lock se recorre la
+// cadena de propietarios y mutex que esperan y, si vuelve al proceso,
+// lock devuelve -7 en vez de bloquearlo. Con 0 no se comprueba.
+#ifndef DETECTAR_INTERBLOQUEOS
+#define DETECTAR_INTERBLOQUEOS 1
+#endif
+#define MAX_GENERACION_MUTEX (0x7FFFFFFF/NUM_MUT)
+#define PALABRAS_MAPA_MUTEX ((NUM_MUT+31)/32)
+// Tabla de rwlocks: identificadores, nombres y mapas de bits de los que
+// tiene abiertos cada proceso como en la de mutex. Cada hilo tiene
+// ademas un mapa de los que esta leyendo.
+#ifndef TAM_HASH_RW
+#define TAM_HASH_RW (2*NUM_RW)
+#endif
+#define MAX_GENERACION_RW (0x7FFFFFFF/NUM_RW)
+#define PALABRAS_MAPA_RW ((NUM_RW+31)/32)
 //
 
 #include "const.h"
 #include "HAL.h"
 #include "llamsis.h"
 
+/*
+ *
+ * Definicion del tipo que corresponde con la cabecera de una lista
+ * de BCPs. Este tipo se puede usar para diversas listas (procesos listos,
+ * procesos bloqueados en sem�foro, etc.).
+ *
+ */
+
+typedef struct{
+	struct BCP_t *primero;
+	struct BCP_t *ultimo;
+} lista_BCPs;
+
 /*
  *
  * Definicion del tipo que corresponde con el BCP.
@@ -37,56 +151,250 @@
  *
  */
 
+// Creado por nosotros
+/*
+ * Ticks que ha ejecutado un proceso, con todos sus hilos, en modo
+ * usuario y en modo sistema (los mismos campos que en servicios.h)
+ */
+struct tiempos_ejec {
+	int usuario;
+	int sistema;
+};
+
+/*
+ * Estado de un mutex que comparte el nucleo con los procesos y cabecera
+ * de la pila de cada hilo (los mismos que en servicios.h). La palabra
+ * solo la cambian el nucleo y los procesos con operaciones atomicas: un
+ * proceso coge un mutex libre y suelta uno que nadie espera sin llamar
+ * al sistema; en otro caso llama a lock o unlock.
+ */
+#define CERROJO_ESPERAN 0x80000000U
+struct cerrojo_mutex {
+	int id;			/* mutex que ocupa la entrada o -1 */
+	int tipo;
+	unsigned int palabra;	/* propietario+1 (0 libre) | CERROJO_ESPERAN */
+	int veces;		/* veces que lo ha bloqueado su propietario */
+} __attribute__((aligned(64)));
+
+struct cabecera_pila {
+	unsigned int propietario;	/* lo que pone en la palabra de un mutex */
+	const unsigned int *mutex_abiertos; /* mapa de los de su proceso */
+	void *reserva;			/* memoria de la que sale la pila */
+};
+//
+
 typedef struct BCP_t *BCPptr;
 
 typedef struct BCP_t {
         int id;				/* ident. del proceso */
-        int estado;			/* TERMINADO|LISTO|EJECUCION|BLOQUEADO*/
+        int estado;			/* TERMINADO|LISTO|EJECUCION|BLOQUEADO|ZOMBI*/
         contexto_t contexto_regs;	/* copia de regs. de UCP */
         void * pila;
 		//Creado por nosotros
-		int dormir_t;
-		int lista_mutex[NUM_MUT_PROC];
+		unsigned long plazo; /* tick absoluto en que vence su espera */
+		int pos_plazo; /* posicion en el monticulo de plazos (-1 si no esta) */
+		unsigned int mutex_abiertos[PALABRAS_MAPA_MUTEX]; /* bit i: el de la entrada i */
 		int num_mutex_asignados;
+		unsigned int rw_abiertos[PALABRAS_MAPA_RW]; /* bit i: el de la entrada i */
+		int num_rw_asignados;
+		unsigned int rw_leyendo[PALABRAS_MAPA_RW]; /* los que lee este hilo */
 		int tiempo_rodaja;
+		int prioridad;
+		int prioridad_heredada; /* la mayor de los que esperan sus mutex o -1 */
+		int nivel; /* nivel de la cola de listos en que esta */
+		struct mutex_t *mutex_esperado; /* mutex en que esta bloqueado */
+		unsigned long instante_despertar; /* tick en que desperto */
+		int despertado; /* vuelve de dormir y aun no ha ejecutado */
+		unsigned int epoca_mlfq; /* ultimo impulso MLFQ que le afecto */
+		int ucp; /* procesador en que ejecuta o en cuya cola esta */
+		unsigned int afinidad; /* procesadores en que puede ejecutar */
+		unsigned long ultimo_tick; /* tick en que ejecuto por ultima vez */
+		int imagen_cache; /* entrada de su imagen en la cache o -1 */
+		struct BCP_t *proceso; /* proceso del hilo (el propio BCP si no es hilo) */
+		int num_hilos; /* hilos vivos del proceso, incluido el inicial */
+		void *funcion_hilo; /* funcion que ejecuta el hilo y su argumento */
+		void *arg_hilo;
+		int estado_salida; /* codigo con que termino el proceso */
+		struct BCP_t *padre; /* proceso que lo creo (NULL si ya no existe) */
+		struct BCP_t *primer_hijo; /* hijos que no ha recogido, enlazados */
+		struct BCP_t *hermano_sig; /* por hermano_sig y hermano_ant */
+		struct BCP_t *hermano_ant;
+		lista_BCPs esperando_hijos; /* hilos propios en esperar_proceso */
+		struct tiempos_ejec tiempos; /* ticks del proceso y sus hilos */
+		struct BCP_t *sig_hash_id; /* su lista en hash_ids, enlazada */
+		struct BCP_t *ant_hash_id; /* por sig_hash_id y ant_hash_id */
 		//
 	BCPptr siguiente;		/* puntero a otro BCP */
+	BCPptr anterior;		/* BCP anterior en su lista */
 	void *info_mem;			/* descriptor del mapa de memoria */
 } BCP;
 
+
 /*
- *
- * Definicion del tipo que corresponde con la cabecera de una lista
- * de BCPs. Este tipo se puede usar para diversas listas (procesos listos,
- * procesos bloqueados en sem�foro, etc.).
- *
+ * Variable global que representa la tabla de procesos
+ */
+
+BCP tabla_procs[MAX_PROC];
+
+// Creado por nosotros
+/*
+ * Entradas libres de la tabla de procesos: las que han quedado libres,
+ * enlazadas por el campo siguiente, y a partir de num_entradas_usadas
+ * las que no se han usado nunca. Reservar una entrada no depende del
+ * tamano de la tabla y las que no se usan no llegan a ocupar memoria.
  */
+BCP *entradas_libres = NULL;
+int num_entradas_usadas = 0;
 
+/*
+ * Identificador del proximo proceso. Es independiente de la entrada que
+ * ocupa, de modo que no se reutiliza al liberarse esta.
+ */
+unsigned int siguiente_id = 0;
+
+/*
+ * Indice de las entradas en uso de la tabla de procesos por su
+ * identificador: tabla hash de MAX_PROC listas. Como los identificadores
+ * son consecutivos, casi nunca hay mas de un BCP por lista y encontrar
+ * uno no depende del numero de procesos.
+ */
+BCP *hash_ids[MAX_PROC];
+
+/*
+ * Pilas libres que se reutilizan al crear procesos
+ */
+void *pilas_libres[MAX_PILAS_LIBRES];
+int num_pilas_libres = 0;
+
+/*
+ * Cache de imagenes de programas. Una entrada sin imagen esta libre;
+ * las que tienen imagen pero ningun proceso se pueden expulsar.
+ */
 typedef struct{
-	BCP *primero;
-	BCP *ultimo;
-} lista_BCPs;
+	char nombre[MAX_NOM_PROG];
+	void *imagen;		/* descriptor devuelto por crear_imagen */
+	void *pc_inicial;
+	int referencias;	/* procesos que la estan usando */
+	unsigned long usos;	/* procesos que la han usado */
+	unsigned long ultimo_uso; /* orden en que se uso por ultima vez */
+} imagen_programa;
 
+imagen_programa cache_imagenes[MAX_IMAGENES];
+int num_imagenes_libres = 0; // cargadas y sin procesos
+unsigned long contador_usos_imagenes = 0;
 
 /*
- * Variable global que identifica el proceso actual
+ * Recursos de un proceso o hilo terminado pendientes de liberar. Se
+ * copian los datos de la imagen, ya que el BCP del proceso puede quedar
+ * como zombi y liberarlo el padre antes.
  */
+typedef struct{
+	void *pila;
+	BCP *hilo;		/* entrada del hilo que se libera o NULL */
+	BCP *proceso;		/* entrada del proceso que se libera o NULL */
+	int soltar_imagen;	/* era el ultimo hilo del proceso */
+	int imagen_cache;
+	void *info_mem;
+} liberacion_pendiente;
 
-BCP * p_proc_actual=NULL;
+liberacion_pendiente pendientes_liberar[MAX_PENDIENTES_LIBERAR+1];
+int num_pendientes_liberar = 0;
+//
 
 /*
- * Variable global que representa la tabla de procesos
+ * Definicion del tipo que corresponde con la cola de procesos listos.
+ * Hay una lista de BCPs por cada nivel de prioridad y un mapa de bits
+ * con los niveles que tienen algun proceso, de manera que elegir el
+ * siguiente proceso no depende del numero de procesos listos.
  */
+typedef struct{
+	lista_BCPs niveles[NUM_PRIORIDADES];
+	unsigned int mapa;	/* bit i activo si niveles[i] no esta vacia */
+	int num_listos;
+} cola_listos;
 
-BCP tabla_procs[MAX_PROC];
+// Creado por nosotros
+/*
+ * Definicion del tipo que corresponde con un procesador: el proceso que
+ * ejecuta y su propia cola de procesos listos. Sin SMP hay uno solo.
+ */
+typedef struct{
+	BCP *actual;		/* proceso en ejecucion */
+	cola_listos listos;	/* procesos listos asignados al procesador */
+	int ociosa;		/* parada esperando una interrupcion */
+	int prof_nucleo;	/* anidamiento dentro del nucleo (con SMP) */
+	volatile int accediendo_usuario; /* copiando a memoria del proceso */
+#ifdef SMP
+	contexto_t contexto_ocioso; /* el propio, mientras no tiene proceso */
+#endif
+	/* estadisticas */
+	unsigned long ticks_ocupada;
+	unsigned long ticks_ociosa;
+	unsigned long robos;
+	unsigned long migraciones; /* procesos recibidos al repartir */
+} UCP;
+
+UCP tabla_ucps[NUM_UCPS];
 
 /*
- * Variable global que representa la cola de procesos listos
+ * Procesador que ejecuta el codigo del nucleo, y su proceso actual
  */
-lista_BCPs lista_listos = {NULL, NULL};
+#ifdef SMP
+#define UCP_ACTUAL ucp_actual()
+#else
+#define UCP_ACTUAL 0
+#endif
+#define mi_ucp() (&tabla_ucps[UCP_ACTUAL])
+#define p_proc_actual (mi_ucp()->actual)
+
+#ifdef SMP
+/*
+ * Cerrojo del nucleo y procesador que lo tiene
+ */
+cerrojo_t cerrojo_nucleo;
+volatile int ucp_propietaria=-1;
+#endif
+//
 
 // Creado por nosotros
-lista_BCPs lista_procesos_esperando_plazos = {NULL, NULL};
+/*
+ * Monticulo de minimos con los procesos que esperan un plazo, ordenado
+ * por el tick absoluto en que vence. La interrupcion de reloj solo mira
+ * la cima, asi que su coste no depende del numero de procesos dormidos.
+ */
+typedef struct{
+	BCP *procs[MAX_PROC];
+	int num;
+} monticulo_plazos;
+
+monticulo_plazos procesos_esperando_plazos;
+
+/*
+ * Numero de ticks desde el arranque (nunca disminuye)
+ */
+unsigned long ticks_sistema = 0;
+
+/*
+ * Pagina de datos del nucleo que los procesos leen sin hacer una llamada
+ * al sistema (la misma estructura que en servicios.h). El nucleo la
+ * actualiza en cada tick, al crear procesos y al elegir el siguiente
+ * proceso. El proceso en ejecucion y sus tiempos solo valen con un
+ * procesador: con varios, un proceso no sabe en cual ejecuta. Ocupa un
+ * numero entero de lineas de cache para que las entradas de los mutex
+ * empiecen justo detras (ver zona_compartida).
+ */
+struct datos_nucleo {
+	unsigned long ticks;		/* ticks desde el arranque */
+	int num_ucps;
+	int id_actual;			/* proceso en ejecucion */
+	struct tiempos_ejec tiempos_actual; /* sus ticks de usuario y sistema */
+	int procesos_vivos;
+	unsigned long procesos_creados;
+	unsigned long cambios_contexto;
+	unsigned long ints_reloj;	/* ints. de reloj recibidas */
+	int tam_pila;			/* tamano y alineamiento de las pilas */
+	int num_mut;			/* entradas de la tabla de mutex */
+} __attribute__((aligned(64)));
 //
 
 /*
@@ -107,21 +415,143 @@ typedef struct mutex_t{
 	char nombre[MAX_NOM_MUT];
 	int id;
 	int tipo;
-	int estado; // 0 bloqueado 1 desbloqueado
 	int num_procesos_usandolo;
-	mutexPtr siguiente;
-	int veces_bloqueado;
-	int id_proceso_propietario;
+	mutexPtr siguiente; /* siguiente de su lista en la tabla hash */
+	struct cerrojo_mutex *cerrojo; /* propietario y veces, compartidos */
+	struct BCP_t *propietario; /* ultimo BCP propietario que se conoce */
 	lista_BCPs lista_procesos_lock;
 }mutex;
 
+/*
+ * Tabla de mutex del sistema, indexada por la entrada que codifica el
+ * identificador. Como en la de procesos, las entradas que quedan libres
+ * se apilan y a partir de num_entradas_mutex_usadas estan las que no se
+ * han usado nunca. El mutex de cada entrada esta en reserva_mutex, que
+ * no se libera, y tabla_mutex apunta a el mientras la entrada esta
+ * ocupada. Si estan todas ocupadas, crear_mutex espera en
+ * esperando_mutex_libre a que cerrar_mutex libere alguna.
+ */
+mutex reserva_mutex[NUM_MUT];
+mutex *tabla_mutex[NUM_MUT];
+int generacion_mutex[NUM_MUT]; /* veces que se ha reutilizado la entrada */
+int entradas_mutex_libres[NUM_MUT];
+int num_entradas_mutex_libres = 0;
+int num_entradas_mutex_usadas = 0;
+lista_BCPs esperando_mutex_libre = {NULL, NULL};
+
+/*
+ * Zona que se comparte con los procesos: la pagina de datos y, justo
+ * detras, el estado de cada entrada de la tabla de mutex, una por linea
+ * de cache. No contiene punteros: los procesos solo reciben la
+ * direccion de la zona. Comparten el espacio de direcciones del nucleo
+ * y el HAL no permite protegerla, por lo que nada les impide escribir
+ * en la pagina; solo deben hacerlo en las palabras de los mutex.
+ */
+struct {
+	struct datos_nucleo pagina;
+	struct cerrojo_mutex cerrojos[NUM_MUT];
+} zona_compartida __attribute__((aligned(4096)));
+
+/*
+ * Tabla hash con los mutex por nombre, enlazados por el campo siguiente
+ */
+mutex *hash_mutex[TAM_HASH_MUTEX];
+
+/*
+ * Cerrojo de lectores y escritores (rwlock): lo tienen a la vez varios
+ * hilos para leer o uno solo para escribir. Los que lo esperan estan en
+ * dos listas, la de lectores y la de escritores; su preferencia decide a
+ * cuales se da cuando lo esperan de los dos tipos.
+ */
+typedef struct rwlock_t{
+	char nombre[MAX_NOM_MUT];
+	int id;
+	int preferencia; /* PREFERENCIA_LECTORES o PREFERENCIA_ESCRITORES */
+	int num_procesos_usandolo;
+	struct rwlock_t *siguiente; /* siguiente de su lista en la tabla hash */
+	int num_lectores; /* hilos que lo tienen para leer */
+	struct BCP_t *escritor; /* hilo que lo tiene para escribir o NULL */
+	lista_BCPs lectores_esperando;
+	lista_BCPs escritores_esperando;
+}rwlock;
+
+/*
+ * Tabla de rwlocks del sistema y tabla hash por nombre, como las de
+ * mutex. Si estan todas las entradas ocupadas, crear_rwlock espera en
+ * esperando_rw_libre a que cerrar_rwlock libere alguna.
+ */
+rwlock reserva_rw[NUM_RW];
+rwlock *tabla_rw[NUM_RW];
+int generacion_rw[NUM_RW]; /* veces que se ha reutilizado la entrada */
+int entradas_rw_libres[NUM_RW];
+int num_entradas_rw_libres = 0;
+int num_entradas_rw_usadas = 0;
+int num_rw = 0;
+lista_BCPs esperando_rw_libre = {NULL, NULL};
+rwlock *hash_rw[TAM_HASH_RW];
+
+/*
+ * Estadisticas que recoge el nucleo para las pruebas de rendimiento.
+ * Los costes en ciclos solo se miden compilando con ESTADISTICAS, y
+ * entonces se muestran cuando termina el ultimo proceso del sistema.
+ * Los contadores de la pagina de datos se mantienen siempre.
+ */
 typedef struct{
-	mutex *primero;
-	mutex *ultimo;
-} lista_Mutex;
+	/* coste del planificador segun el numero de procesos listos */
+	unsigned long long ciclos_planif[NUM_TRAMOS_LISTOS];
+	unsigned long elecciones_planif[NUM_TRAMOS_LISTOS];
+	/* ticks que espera un proceso desde que despierta hasta que ejecuta */
+	unsigned long despertares;
+	unsigned long ticks_espera_despertar;
+	unsigned long max_espera_despertar;
+	/* coste de la gestion de plazos en la int. de reloj segun dormidos */
+	unsigned long long ciclos_plazos[NUM_TRAMOS_LISTOS];
+	unsigned long ticks_plazos[NUM_TRAMOS_LISTOS];
+	/* interrupciones de reloj recibidas y ticks que no han interrumpido */
+	unsigned long ints_reloj;
+	unsigned long ticks_omitidos;
+	/* cambios de contexto entre procesos y su coste */
+	unsigned long cambios_contexto;
+	unsigned long long ciclos_cambio;
+	/* ciclo en que arranca el reloj, para calcular ciclos por segundo */
+	unsigned long long ciclos_arranque;
+	/* hora de arranque en ms (con SMP se muestra el tiempo total) */
+	unsigned long long ms_arranque;
+	/* creacion y terminacion de procesos y su coste */
+	unsigned long creaciones;
+	unsigned long long ciclos_creacion;
+	unsigned long terminaciones;
+	unsigned long long ciclos_terminacion;
+	/* pilas de los procesos creados sacadas de la cache o nuevas */
+	unsigned long pilas_cache;
+	unsigned long pilas_nuevas;
+	/* imagenes de programas cargadas, sacadas de la cache y expulsadas */
+	unsigned long imagenes_cargadas;
+	unsigned long imagenes_cache;
+	unsigned long imagenes_expulsadas;
+	/* creacion de hilos y su coste */
+	unsigned long creaciones_hilos;
+	unsigned long long ciclos_creacion_hilos;
+	/* liberaciones diferidas, en cuantas tandas y su coste */
+	unsigned long liberaciones_diferidas;
+	unsigned long tandas_liberacion;
+	unsigned long long ciclos_liberacion;
+	/* comprobaciones de interbloqueo al bloquearse en un mutex, cuantas
+	   lo detectaron, mutex recorridos y su coste */
+	unsigned long comprobaciones_interbloqueo;
+	unsigned long interbloqueos;
+	unsigned long mutex_recorridos;
+	unsigned long long ciclos_interbloqueo;
+	/* veces que se coge un rwlock para leer y para escribir, cuantas
+	   esperan y maximo de lectores a la vez */
+	unsigned long lecturas_rw;
+	unsigned long esperas_lectura_rw;
+	unsigned long escrituras_rw;
+	unsigned long esperas_escritura_rw;
+	int max_lectores_rw;
+} estadisticas_t;
 
-// Lista global de mutex del sistema
-lista_Mutex lista_mutex_global = {NULL, NULL};
+estadisticas_t estadisticas;
 //
 /*
  * Prototipos de las rutinas que realiza = NULLn cada llamada al sistema
@@ -137,6 +567,24 @@ int sis_abrir_mutex();
 int sis_lock_mutex();
 int sis_unlock_mutex();
 int sis_cerrar_mutex();
+int sis_fijar_prioridad();
+int sis_fijar_afinidad();
+int sis_crear_procesos();
+int sis_crear_hilo();
+int sis_terminar_hilo();
+int sis_datos_hilo();
+int sis_esperar_proceso();
+int sis_terminar_proceso_estado();
+int sis_tiempos_proceso();
+int sis_pagina_datos();
+int sis_trylock_mutex();
+int sis_lock_timeout_mutex();
+int sis_crear_rwlock();
+int sis_abrir_rwlock();
+int sis_rdlock();
+int sis_wrlock();
+int sis_rwunlock();
+int sis_cerrar_rwlock();
 //
 
 /*
@@ -152,7 +600,25 @@ servicio tabla_servicios[NSERVICIOS]={	{sis_crear_proceso},
 					{sis_abrir_mutex},
 					{sis_lock_mutex},
 					{sis_unlock_mutex},
-					{sis_cerrar_mutex}};
+					{sis_cerrar_mutex},
+					{sis_fijar_prioridad},
+					{sis_fijar_afinidad},
+					{sis_crear_procesos},
+					{sis_crear_hilo},
+					{sis_terminar_hilo},
+					{sis_datos_hilo},
+					{sis_esperar_proceso},
+					{sis_terminar_proceso_estado},
+					{sis_tiempos_proceso},
+					{sis_pagina_datos},
+					{sis_trylock_mutex},
+					{sis_lock_timeout_mutex},
+					{sis_crear_rwlock},
+					{sis_abrir_rwlock},
+					{sis_rdlock},
+					{sis_wrlock},
+					{sis_rwunlock},
+					{sis_cerrar_rwlock}};
 					//
 
 #endif /* _KERNEL_H */
@@ -19,7 +19,7 @@
 #define _LLAMSIS_H
 
 /* Numero de llamadas disponibles */
-#define NSERVICIOS 10 //3
+#define NSERVICIOS 28 //3
 
 #define CREAR_PROCESO 0
 #define TERMINAR_PROCESO 1
@@ -32,6 +32,24 @@
 #define LOCK 7
 #define UNLOCK 8
 #define CERRAR_MUTEX 9
+#define FIJAR_PRIORIDAD 10
+#define FIJAR_AFINIDAD 11
+#define CREAR_PROCESOS 12
+#define CREAR_HILO 13
+#define TERMINAR_HILO 14
+#define DATOS_HILO 15
+#define ESPERAR_PROCESO 16
+#define TERMINAR_PROCESO_ESTADO 17
+#define TIEMPOS_PROCESO 18
+#define PAGINA_DATOS 19
+#define TRYLOCK 20
+#define LOCK_TIMEOUT 21
+#define CREAR_RWLOCK 22
+#define ABRIR_RWLOCK 23
+#define RDLOCK 24
+#define WRLOCK 25
+#define RWUNLOCK 26
+#define CERRAR_RWLOCK 27
 //
 
 #endif /* _LLAMSIS_H */
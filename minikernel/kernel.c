@@ -18,148 +18,1987 @@
 #include "string.h"
 
 // Creado por nosotros
-int nivelAnterior; // Variable global que almacena el nivel previo a una interrupcion
 int num_mutex = 0; // Variable global que almacena el numero actual de mutex en el sistema;
-int id_mutex = 0;
+int num_procesos_vivos = 0; // Numero de procesos existentes, para saber cuando termina el sistema
+unsigned int epoca_mlfq = 0; // Numero de impulsos MLFQ realizados
+unsigned long proximo_impulso_mlfq = PERIODO_IMPULSO_MLFQ; // Tick del siguiente impulso MLFQ
+int ticks_por_int_reloj = 1; // Ticks que representa la siguiente int. de reloj
+unsigned long long inicio_cambio = 0; // Ciclo en que empezo el cambio de contexto en curso (1 sin ESTADISTICAS)
+unsigned long proximo_equilibrado = PERIODO_EQUILIBRADO; // Tick del siguiente reparto de listos (con SMP)
 //
 
 /*
  *
  * Funciones relacionadas con la tabla de procesos:
- *	iniciar_tabla_proc buscar_BCP_libre
+ *	iniciar_tabla_proc reservar_BCP liberar_BCP buscar_BCP
  *
  */
 
 /*
- * Funci�n que inicia la tabla de procesos
+ * Funcion que inicia la tabla de procesos. No hace falta recorrerla:
+ * las entradas se reparten en orden la primera vez.
  */
 static void iniciar_tabla_proc(){
+	entradas_libres=NULL;
+	num_entradas_usadas=0;
+}
+
+/*
+ * Funcion que reserva una entrada libre en la tabla de procesos: la
+ * ultima que se libero o, si no hay, la primera que no se ha usado
+ * nunca. Le asigna el siguiente identificador y la anade al indice
+ * hash_ids. Devuelve NULL si la tabla esta llena.
+ */
+static BCP * reservar_BCP(){
+	BCP *proc=entradas_libres, **lista;
+
+	if (proc!=NULL)
+		entradas_libres=proc->siguiente;
+	else if (num_entradas_usadas<MAX_PROC)
+		proc=&tabla_procs[num_entradas_usadas++];
+	else
+		return NULL;
+
+	proc->id=(int)(siguiente_id++ & 0x7FFFFFFF);
+	lista=&hash_ids[proc->id%MAX_PROC];
+	proc->ant_hash_id=NULL;
+	proc->sig_hash_id=*lista;
+	if (*lista!=NULL)
+		(*lista)->ant_hash_id=proc;
+	*lista=proc;
+	return proc;
+}
+
+/*
+ * Funcion que devuelve una entrada a la tabla de procesos y la quita
+ * del indice hash_ids
+ */
+static void liberar_BCP(BCP * proc){
+	if (proc->ant_hash_id!=NULL)
+		proc->ant_hash_id->sig_hash_id=proc->sig_hash_id;
+	else
+		hash_ids[proc->id%MAX_PROC]=proc->sig_hash_id;
+	if (proc->sig_hash_id!=NULL)
+		proc->sig_hash_id->ant_hash_id=proc->ant_hash_id;
+
+	proc->estado=NO_USADA;
+	proc->siguiente=entradas_libres;
+	entradas_libres=proc;
+}
+
+/*
+ * Funcion que devuelve el BCP en uso con ese identificador o NULL si no
+ * hay ninguno
+ */
+static BCP * buscar_BCP(int id){
+	BCP *proc;
+
+	if (id<0)
+		return NULL;
+	for (proc=hash_ids[id%MAX_PROC]; proc!=NULL; proc=proc->sig_hash_id)
+		if (proc->id==id)
+			return proc;
+	return NULL;
+}
+
+/*
+ *
+ * Funciones de la cache de pilas:
+ *	nueva_pila iniciar_cache_pilas reservar_pila devolver_pila
+ *
+ * Las pilas estan alineadas a TAM_PILA y empiezan por una cabecera con
+ * la que el hilo que la usa sabe quien es a partir de su puntero de
+ * pila (ver cerrojo_mutex).
+ */
+
+#if TAM_PILA & (TAM_PILA-1)
+#error "TAM_PILA debe ser potencia de 2"
+#endif
+
+/*
+ * Crea una pila alineada a su tamano, reservando el doble
+ */
+static void * nueva_pila(){
+	char *reserva=crear_pila(2*TAM_PILA);
+	struct cabecera_pila *cab;
+
+	if (reserva==NULL)
+		return NULL;
+	cab=(struct cabecera_pila *)(((unsigned long)reserva+TAM_PILA-1) &
+		~(unsigned long)(TAM_PILA-1));
+	cab->reserva=reserva;
+	return cab;
+}
+
+/*
+ * Reserva las pilas iniciales de la cache y las recorre para que sus
+ * paginas ya esten en memoria cuando las use un proceso
+ */
+static void iniciar_cache_pilas(){
+	void *pila;
+
+	while (num_pilas_libres<PILAS_INICIALES && num_pilas_libres<MAX_PILAS_LIBRES){
+		if ((pila=nueva_pila())==NULL)
+			break;
+		memset((struct cabecera_pila *)pila+1, 0,
+			TAM_PILA-sizeof(struct cabecera_pila));
+		pilas_libres[num_pilas_libres++]=pila;
+	}
+}
+
+/*
+ * Devuelve una pila para un proceso nuevo: la ultima que se guardo en
+ * la cache o, si esta vacia, una nueva
+ */
+static void * reservar_pila(){
+	if (num_pilas_libres>0){
+		estadisticas.pilas_cache++;
+		return pilas_libres[--num_pilas_libres];
+	}
+	estadisticas.pilas_nuevas++;
+	return nueva_pila();
+}
+
+/*
+ * Guarda en la cache la pila de un proceso que termina o, si esta
+ * llena, la libera
+ */
+static void devolver_pila(void * pila){
+	if (num_pilas_libres<MAX_PILAS_LIBRES)
+		pilas_libres[num_pilas_libres++]=pila;
+	else
+		liberar_pila(((struct cabecera_pila *)pila)->reserva);
+}
+
+/*
+ *
+ * Funciones de la cache de imagenes de programas:
+ *	obtener_imagen compartir_imagen soltar_imagen precargar_imagenes
+ *	vaciar_cache_imagenes
+ *
+ * El HAL termina el sistema cuando se libera la ultima imagen cargada,
+ * por lo que una imagen solo se libera si hay otras cargadas o si ya
+ * no queda ningun proceso.
+ */
+
+/*
+ * Devuelve la entrada de la cache con la imagen de un programa o -1
+ */
+static int buscar_imagen(char *prog){
+	int i;
+
+	for (i=0; i<MAX_IMAGENES; i++)
+		if (cache_imagenes[i].imagen!=NULL &&
+				strcmp(cache_imagenes[i].nombre, prog)==0)
+			return i;
+	return -1;
+}
+
+/*
+ * Libera la imagen de una entrada de la cache que no usa ningun proceso
+ */
+static void expulsar_imagen(int i){
+	void *imagen=cache_imagenes[i].imagen;
+
+	cache_imagenes[i].imagen=NULL;
+	num_imagenes_libres--;
+	estadisticas.imagenes_expulsadas++;
+	liberar_imagen(imagen);
+}
+
+/*
+ * Devuelve la entrada que se expulsa segun la politica de la cache
+ * entre las que no usa ningun proceso, o -1 si no hay ninguna
+ */
+static int elegir_expulsada(){
+	int i, elegida=-1;
+	imagen_programa *img;
+
+	for (i=0; i<MAX_IMAGENES; i++){
+		img=&cache_imagenes[i];
+		if (img->imagen==NULL || img->referencias>0)
+			continue;
+#ifdef IMAGENES_LFU
+		if (elegida==-1 || img->usos<cache_imagenes[elegida].usos)
+#else
+		if (elegida==-1 || img->ultimo_uso<cache_imagenes[elegida].ultimo_uso)
+#endif
+			elegida=i;
+	}
+	return elegida;
+}
+
+/*
+ * Guarda en la cache una imagen recien cargada, sin procesos que la
+ * usen. Si no hay entradas libres expulsa otra (la nueva ya esta
+ * cargada, asi que no es la ultima). Devuelve -1 si no cabe.
+ */
+static int guardar_imagen(char *prog, void *imagen, void *pc_inicial){
+	int i;
+	imagen_programa *img;
+
+	if (strlen(prog)>=MAX_NOM_PROG)
+		return -1;
+	for (i=0; i<MAX_IMAGENES && cache_imagenes[i].imagen!=NULL; i++);
+	if (i==MAX_IMAGENES){
+		if ((i=elegir_expulsada())==-1)
+			return -1;
+		expulsar_imagen(i);
+	}
+
+	img=&cache_imagenes[i];
+	strcpy(img->nombre, prog);
+	img->imagen=imagen;
+	img->pc_inicial=pc_inicial;
+	img->referencias=0;
+	img->usos=0;
+	img->ultimo_uso=++contador_usos_imagenes;
+	num_imagenes_libres++;
+	return i;
+}
+
+/*
+ * Un proceso nuevo pasa a usar la imagen de una entrada de la cache
+ */
+static void * compartir_imagen(BCP * proc, int i, void **pc_inicial){
+	imagen_programa *img=&cache_imagenes[i];
+
+	if (img->referencias++==0)
+		num_imagenes_libres--;
+	img->usos++;
+	img->ultimo_uso=++contador_usos_imagenes;
+	proc->imagen_cache=i;
+	*pc_inicial=img->pc_inicial;
+	return img->imagen;
+}
+
+/*
+ * Obtiene la imagen de un programa para un proceso nuevo. Si no esta en
+ * la cache la carga el HAL y se guarda; si no cabe, el proceso usa una
+ * imagen propia. Devuelve NULL si no se puede cargar.
+ */
+static void * obtener_imagen(BCP * proc, char *prog, void **pc_inicial){
+	void *imagen;
+	int i=buscar_imagen(prog);
+
+	if (i!=-1)
+		estadisticas.imagenes_cache++;
+	else {
+		if ((imagen=crear_imagen(prog, pc_inicial))==NULL)
+			return NULL;
+		estadisticas.imagenes_cargadas++;
+		if ((i=guardar_imagen(prog, imagen, *pc_inicial))==-1){
+			proc->imagen_cache=-1;
+			return imagen;
+		}
+	}
+	return compartir_imagen(proc, i, pc_inicial);
+}
+
+/*
+ * Un proceso que termina deja de usar su imagen (la entrada de la cache
+ * o, si es -1, una propia). Si con ella hay mas de MAX_IMAGENES_LIBRES
+ * sin procesos, se expulsa una.
+ */
+static void soltar_imagen(int entrada, void *info_mem){
+	imagen_programa *img;
+
+	if (entrada==-1){
+		liberar_imagen(info_mem);
+		return;
+	}
+	img=&cache_imagenes[entrada];
+	if (--img->referencias==0 && ++num_imagenes_libres>MAX_IMAGENES_LIBRES)
+		expulsar_imagen(elegir_expulsada());
+}
+
+/*
+ * Carga al arrancar los programas de IMAGENES_PRECARGADAS
+ */
+static void precargar_imagenes(){
+	char *precargadas[]={IMAGENES_PRECARGADAS};
+	void *imagen, *pc_inicial;
+	int i;
+
+	for (i=0; i<(int)(sizeof(precargadas)/sizeof(precargadas[0])) &&
+			num_imagenes_libres<MAX_IMAGENES_LIBRES; i++)
+		if (buscar_imagen(precargadas[i])==-1 &&
+				(imagen=crear_imagen(precargadas[i], &pc_inicial))!=NULL){
+			estadisticas.imagenes_cargadas++;
+			guardar_imagen(precargadas[i], imagen, pc_inicial);
+		}
+}
+
+/*
+ * Libera todas las imagenes cuando ya no quedan procesos; al liberar la
+ * ultima el HAL termina el sistema
+ */
+static void vaciar_cache_imagenes(){
+	int i;
+
+	for (i=0; i<MAX_IMAGENES; i++)
+		if (cache_imagenes[i].imagen!=NULL)
+			expulsar_imagen(i);
+}
+
+/*
+ *
+ * Funciones que facilitan el manejo de las listas de BCPs
+ *	insertar_ultimo eliminar_primero eliminar_elem
+ *
+ * Las listas estan doblemente enlazadas (campos siguiente y anterior),
+ * de modo que sacar cualquier BCP no depende de su posicion. Un BCP
+ * solo puede estar en una lista a la vez.
+ *
+ * NOTA: PRIMERO SE DEBE LLAMAR A eliminar Y LUEGO A insertar
+ */
+
+/*
+ * Inserta un BCP al final de la lista.
+ */
+static void insertar_ultimo(lista_BCPs *lista, BCP * proc){
+	if (lista->primero==NULL)
+		lista->primero= proc;
+	else
+		lista->ultimo->siguiente=proc;
+	proc->anterior=lista->ultimo;
+	lista->ultimo= proc;
+	proc->siguiente=NULL;
+}
+
+/*
+ * Elimina el primer BCP de la lista.
+ */
+static void eliminar_primero(lista_BCPs *lista){
+
+	if (lista->ultimo==lista->primero)
+		lista->ultimo=NULL;
+	lista->primero=lista->primero->siguiente;
+	if (lista->primero!=NULL)
+		lista->primero->anterior=NULL;
+}
+
+/*
+ * Elimina un determinado BCP de la lista, que debe estar en ella.
+ */
+static void eliminar_elem(lista_BCPs *lista, BCP * proc){
+	if (proc->anterior==NULL)
+		lista->primero=proc->siguiente;
+	else
+		proc->anterior->siguiente=proc->siguiente;
+	if (proc->siguiente==NULL)
+		lista->ultimo=proc->anterior;
+	else
+		proc->siguiente->anterior=proc->anterior;
+}
+
+/*
+ *
+ * Funciones que manejan la cola de listos por prioridades
+ *	insertar_listo eliminar_listo prioridad_maxima_lista
+ *
+ */
+
+#ifdef MLFQ
+/*
+ * Inserta un BCP al principio de la lista. Se usa para mantener
+ * al proceso en ejecucion como primero de su nivel.
+ */
+static void insertar_primero(lista_BCPs *lista, BCP * proc){
+	proc->siguiente=lista->primero;
+	proc->anterior=NULL;
+	if (lista->primero==NULL)
+		lista->ultimo=proc;
+	else
+		lista->primero->anterior=proc;
+	lista->primero=proc;
+}
+#endif
+
+/*
+ * Devuelve la cola de listos del procesador al que esta asignado un proceso
+ */
+static cola_listos * cola_de(BCP * proc){
+	return &tabla_ucps[proc->ucp].listos;
+}
+
+/*
+ * Prioridad con que se planifica un proceso: la suya o, si es mayor, la
+ * que hereda de los procesos que esperan mutex que tiene
+ */
+static int prioridad_efectiva(BCP * proc){
+	return proc->prioridad_heredada>proc->prioridad ?
+		proc->prioridad_heredada : proc->prioridad;
+}
+
+/*
+ * Inserta un BCP al final del nivel que le corresponde por su prioridad.
+ */
+static void insertar_listo(BCP * proc){
+	cola_listos *cola=cola_de(proc);
+
+#ifdef MLFQ
+	/* si estaba bloqueado durante un impulso, vuelve al nivel superior */
+	if (proc->epoca_mlfq!=epoca_mlfq){
+		proc->epoca_mlfq=epoca_mlfq;
+		proc->prioridad=NUM_PRIORIDADES-1;
+	}
+#endif
+	proc->nivel=prioridad_efectiva(proc);
+	insertar_ultimo(&cola->niveles[proc->nivel], proc);
+	cola->mapa|=1U<<proc->nivel;
+	cola->num_listos++;
+}
+
+/*
+ * Elimina un BCP de la cola de listos, este donde este de su nivel
+ */
+static void eliminar_listo(BCP * proc){
+	cola_listos *cola=cola_de(proc);
+	lista_BCPs *nivel=&cola->niveles[proc->nivel];
+
+	eliminar_elem(nivel, proc);
+	if (nivel->primero==NULL)
+		cola->mapa&=~(1U<<proc->nivel);
+	cola->num_listos--;
+}
+
+#ifdef MLFQ
+/*
+ * Inserta el proceso en ejecucion al principio de su nivel
+ */
+static void insertar_listo_actual(BCP * proc){
+	cola_listos *cola=cola_de(proc);
+
+	proc->nivel=prioridad_efectiva(proc);
+	insertar_primero(&cola->niveles[proc->nivel], proc);
+	cola->mapa|=1U<<proc->nivel;
+	cola->num_listos++;
+}
+#endif
+
+/*
+ * Devuelve el nivel mas prioritario con procesos listos o -1 si no hay
+ */
+static int prioridad_maxima_lista(cola_listos * cola){
+	if (cola->mapa==0)
+		return -1;
+	return (int)(sizeof(unsigned int)*8-1)-__builtin_clz(cola->mapa);
+}
+
+#ifdef ESTADISTICAS
+/*
+ * Lee el contador de ciclos del procesador (usado en las estadisticas)
+ */
+static inline unsigned long long leer_ciclos(){
+	return __builtin_ia32_rdtsc();
+}
+
+/*
+ * Devuelve el tramo de las estadisticas (log2) que corresponde a n>0
+ */
+static int tramo_log2(int n){
+	int tramo=(int)(sizeof(unsigned int)*8-1)-__builtin_clz((unsigned int)n);
+
+	return tramo<NUM_TRAMOS_LISTOS ? tramo : NUM_TRAMOS_LISTOS-1;
+}
+
+/*
+ * Muestra las estadisticas recogidas. Se llama al terminar el ultimo proceso
+ */
+static void mostrar_estadisticas(){
+	int i;
+	unsigned long long ciclos_seg=0;
+
+	printk("-> ESTADISTICAS DEL PLANIFICADOR\n");
+	for (i=0; i<NUM_TRAMOS_LISTOS; i++)
+		if (estadisticas.elecciones_planif[i]>0)
+			printk("   listos %d-%d: %lu elecciones, %llu ciclos/eleccion\n",
+				1<<i, (1<<(i+1))-1, estadisticas.elecciones_planif[i],
+				estadisticas.ciclos_planif[i]/estadisticas.elecciones_planif[i]);
+	if (estadisticas.despertares>0)
+		printk("   espera tras despertar: %lu despertares, media %lu ticks, max %lu ticks\n",
+			estadisticas.despertares,
+			estadisticas.ticks_espera_despertar/estadisticas.despertares,
+			estadisticas.max_espera_despertar);
+	for (i=0; i<NUM_TRAMOS_LISTOS; i++)
+		if (estadisticas.ticks_plazos[i]>0)
+			printk("   dormidos %d-%d: %lu ticks, %llu ciclos/tick en plazos\n",
+				1<<i, (1<<(i+1))-1, estadisticas.ticks_plazos[i],
+				estadisticas.ciclos_plazos[i]/estadisticas.ticks_plazos[i]);
+	printk("   ticks totales: %lu, ints. de reloj: %lu, ticks omitidos: %lu\n",
+		ticks_sistema, estadisticas.ints_reloj, estadisticas.ticks_omitidos);
+	if (ticks_sistema>0)
+		ciclos_seg=(leer_ciclos()-estadisticas.ciclos_arranque)*TICK/ticks_sistema;
+	if (estadisticas.cambios_contexto>0 && ciclos_seg>0){
+		unsigned long long ciclos_cambio=
+			estadisticas.ciclos_cambio/estadisticas.cambios_contexto;
+
+		printk("   cambios de contexto: %lu, %llu ciclos/cambio (%llu cambios/s)\n",
+			estadisticas.cambios_contexto, ciclos_cambio,
+			ciclos_cambio>0 ? ciclos_seg/ciclos_cambio : 0);
+	}
+	if (estadisticas.creaciones>0){
+		unsigned long long ciclos_creacion=
+			estadisticas.ciclos_creacion/estadisticas.creaciones;
+
+		printk("   procesos creados: %lu, %llu ciclos/creacion (%llu creaciones/s), pilas: %lu de la cache y %lu nuevas\n",
+			estadisticas.creaciones, ciclos_creacion,
+			ciclos_creacion>0 ? ciclos_seg/ciclos_creacion : 0,
+			estadisticas.pilas_cache, estadisticas.pilas_nuevas);
+		printk("   imagenes de programas: %lu cargadas, %lu de la cache, %lu expulsadas\n",
+			estadisticas.imagenes_cargadas, estadisticas.imagenes_cache,
+			estadisticas.imagenes_expulsadas);
+	}
+	if (estadisticas.creaciones_hilos>0){
+		unsigned long long ciclos_creacion=
+			estadisticas.ciclos_creacion_hilos/estadisticas.creaciones_hilos;
+
+		printk("   hilos creados: %lu, %llu ciclos/creacion (%llu creaciones/s)\n",
+			estadisticas.creaciones_hilos, ciclos_creacion,
+			ciclos_creacion>0 ? ciclos_seg/ciclos_creacion : 0);
+	}
+	if (estadisticas.liberaciones_diferidas>0)
+		printk("   liberaciones diferidas: %lu en %lu tandas, %llu ciclos/liberacion\n",
+			estadisticas.liberaciones_diferidas, estadisticas.tandas_liberacion,
+			estadisticas.ciclos_liberacion/estadisticas.liberaciones_diferidas);
+	if (estadisticas.comprobaciones_interbloqueo>0)
+		printk("   interbloqueos: %lu en %lu comprobaciones, %lu mutex recorridos, %llu ciclos/comprobacion\n",
+			estadisticas.interbloqueos, estadisticas.comprobaciones_interbloqueo,
+			estadisticas.mutex_recorridos,
+			estadisticas.ciclos_interbloqueo/estadisticas.comprobaciones_interbloqueo);
+	if (estadisticas.lecturas_rw+estadisticas.escrituras_rw>0)
+		printk("   rwlocks: %lu lecturas (%lu esperaron, max %d a la vez), %lu escrituras (%lu esperaron)\n",
+			estadisticas.lecturas_rw, estadisticas.esperas_lectura_rw,
+			estadisticas.max_lectores_rw, estadisticas.escrituras_rw,
+			estadisticas.esperas_escritura_rw);
+	if (estadisticas.terminaciones>0){
+		unsigned long long ciclos_terminacion=
+			estadisticas.ciclos_terminacion/estadisticas.terminaciones;
+
+		printk("   procesos e hilos terminados: %lu, %llu ciclos/terminacion (%llu terminaciones/s)\n",
+			estadisticas.terminaciones, ciclos_terminacion,
+			ciclos_terminacion>0 ? ciclos_seg/ciclos_terminacion : 0);
+	}
+#ifdef SMP
+	printk("   tiempo total: %llu ms con %d procesadores\n",
+		leer_reloj_CMOS()-estadisticas.ms_arranque, NUM_UCPS);
+	for (i=0; i<NUM_UCPS; i++)
+		printk("   UCP %d: %lu ticks ocupada, %lu ticks ociosa, %lu robos, %lu migraciones\n",
+			i, tabla_ucps[i].ticks_ocupada, tabla_ucps[i].ticks_ociosa,
+			tabla_ucps[i].robos, tabla_ucps[i].migraciones);
+#endif
+}
+#endif
+
+/*
+ *
+ * Funciones del cerrojo del nucleo (solo con SMP)
+ *	entrar_nucleo salir_nucleo soltar_nucleo retomar_nucleo
+ *
+ * Todo el codigo del nucleo ejecuta con el cerrojo tomado. Las
+ * interrupciones que se anidan en el mismo procesador solo aumentan la
+ * profundidad. El cerrojo sigue tomado durante un cambio de contexto:
+ * lo suelta el proceso entrante cuando sale del nucleo.
+ */
+
+#ifdef SMP
+static void entrar_nucleo(){
+	/* sin ints.: una que llegara antes de anotar al propietario
+	   esperaria para siempre a un cerrojo de su propio procesador */
+	int nivel=fijar_nivel_int(NIVEL_3);
+
+	if (ucp_propietaria!=UCP_ACTUAL){
+		bloquear_cerrojo(&cerrojo_nucleo);
+		ucp_propietaria=UCP_ACTUAL;
+	}
+	mi_ucp()->prof_nucleo++;
+	fijar_nivel_int(nivel);
+}
+
+static void salir_nucleo(){
+	int nivel=fijar_nivel_int(NIVEL_3);
+
+	if (--mi_ucp()->prof_nucleo==0){
+		ucp_propietaria=-1;
+		desbloquear_cerrojo(&cerrojo_nucleo);
+	}
+	fijar_nivel_int(nivel);
+}
+
+/*
+ * Suelta el cerrojo del todo (para esperar una interrupcion) y devuelve
+ * la profundidad que tenia, que se recupera con retomar_nucleo
+ */
+static int soltar_nucleo(){
+	int prof=mi_ucp()->prof_nucleo;
+
+	mi_ucp()->prof_nucleo=1;
+	salir_nucleo();
+	return prof;
+}
+
+static void retomar_nucleo(int prof){
+	entrar_nucleo();
+	mi_ucp()->prof_nucleo=prof;
+}
+#else
+#define entrar_nucleo()
+#define salir_nucleo()
+#endif
+
+/*
+ *
+ * Funciones de las colas multinivel realimentadas
+ *	rodaja_nivel bajar_nivel subir_nivel impulsar_niveles
+ *
+ * Sin MLFQ todos los procesos tienen la misma rodaja y nunca cambian
+ * de nivel por si solos.
+ */
+
+/*
+ * Devuelve la rodaja que corresponde al nivel de un proceso
+ */
+static int rodaja_nivel(BCP * proc){
+#ifdef MLFQ
+	int profundidad=NUM_PRIORIDADES-1-proc->prioridad;
+
+	if (profundidad>=NIVELES_MLFQ)
+		profundidad=NIVELES_MLFQ-1;
+	return RODAJA_BASE_MLFQ<<profundidad;
+#else
+	return TICKS_POR_RODAJA;
+#endif
+}
+
+/*
+ * Un proceso que agota su rodaja baja un nivel. No debe estar en listos.
+ */
+static void bajar_nivel(BCP * proc){
+#ifdef MLFQ
+	if (proc->prioridad>NUM_PRIORIDADES-NIVELES_MLFQ)
+		proc->prioridad--;
+#endif
+}
+
+/*
+ * Un proceso que se bloquea sin haber gastado la mitad de su rodaja
+ * sube un nivel; si la ha gastado, se queda en el que esta.
+ * No debe estar en listos.
+ */
+static void subir_nivel(BCP * proc){
+#ifdef MLFQ
+	if (proc->tiempo_rodaja*2>rodaja_nivel(proc) &&
+			proc->prioridad<NUM_PRIORIDADES-1)
+		proc->prioridad++;
+#endif
+}
+
+#ifdef MLFQ
+/*
+ * Lleva todos los procesos listos al nivel superior. Los bloqueados
+ * suben cuando vuelven a listos, al ver que ha cambiado la epoca.
+ */
+static void impulsar_niveles(){
+	int prio, i;
+	BCP *proc, *actual;
+	cola_listos *cola;
+
+	epoca_mlfq++;
+	for (i=0; i<NUM_UCPS; i++){
+		cola=&tabla_ucps[i].listos;
+		actual=tabla_ucps[i].actual;
+		for (prio=0; prio<NUM_PRIORIDADES-1; prio++)
+			while ((proc=cola->niveles[prio].primero)!=NULL){
+				eliminar_listo(proc);
+				if (proc==actual){
+					proc->epoca_mlfq=epoca_mlfq;
+					proc->prioridad=NUM_PRIORIDADES-1;
+					insertar_listo_actual(proc);
+				}
+				else
+					insertar_listo(proc);
+			}
+		if (actual!=NULL && actual->estado==LISTO)
+			actual->epoca_mlfq=epoca_mlfq;
+	}
+}
+#endif
+
+/*
+ *
+ * Funciones que manejan el monticulo de procesos que esperan un plazo
+ *	insertar_plazo eliminar_plazo
+ *
+ */
+
+/*
+ * Coloca un proceso en la posicion pos del monticulo
+ */
+static void colocar_plazo(BCP * proc, int pos){
+	procesos_esperando_plazos.procs[pos]=proc;
+	proc->pos_plazo=pos;
+}
+
+/*
+ * Sube el proceso de la posicion pos mientras venza antes que su padre
+ */
+static void flotar_plazo(int pos){
+	BCP **procs=procesos_esperando_plazos.procs;
+	BCP *proc=procs[pos];
+
+	while (pos>0 && procs[(pos-1)/2]->plazo>proc->plazo){
+		colocar_plazo(procs[(pos-1)/2], pos);
+		pos=(pos-1)/2;
+	}
+	colocar_plazo(proc, pos);
+}
+
+/*
+ * Baja el proceso de la posicion pos mientras venza despues que un hijo
+ */
+static void hundir_plazo(int pos){
+	BCP **procs=procesos_esperando_plazos.procs;
+	int num=procesos_esperando_plazos.num;
+	BCP *proc=procs[pos];
+	int hijo;
+
+	while ((hijo=2*pos+1)<num){
+		if (hijo+1<num && procs[hijo+1]->plazo<procs[hijo]->plazo)
+			hijo++;
+		if (procs[hijo]->plazo>=proc->plazo)
+			break;
+		colocar_plazo(procs[hijo], pos);
+		pos=hijo;
+	}
+	colocar_plazo(proc, pos);
+}
+
+/*
+ * Inserta un proceso cuyo campo plazo ya esta fijado
+ */
+static void insertar_plazo(BCP * proc){
+	colocar_plazo(proc, procesos_esperando_plazos.num++);
+	flotar_plazo(proc->pos_plazo);
+}
+
+/*
+ * Elimina un proceso del monticulo, este donde este
+ */
+static void eliminar_plazo(BCP * proc){
+	int pos=proc->pos_plazo;
+	BCP *ultimo=procesos_esperando_plazos.procs[--procesos_esperando_plazos.num];
+
+	proc->pos_plazo=-1;
+	if (ultimo==proc)
+		return;
+	colocar_plazo(ultimo, pos);
+	if (pos>0 && procesos_esperando_plazos.procs[(pos-1)/2]->plazo>ultimo->plazo)
+		flotar_plazo(pos);
+	else
+		hundir_plazo(pos);
+}
+
+/*
+ *
+ * Funciones de la liberacion diferida de procesos terminados:
+ *	anadir_pendiente liberar_pendientes
+ *
+ */
+
+/*
+ * Libera de una vez los recursos de todos los procesos y hilos
+ * terminados que estan pendientes
+ */
+static void liberar_pendientes(){
+	liberacion_pendiente *pend;
+	int i;
+#ifdef ESTADISTICAS
+	unsigned long long ini;
+#endif
+
+	if (num_pendientes_liberar==0)
+		return;
+#ifdef ESTADISTICAS
+	ini=leer_ciclos();
+#endif
+	for (i=0; i<num_pendientes_liberar; i++){
+		pend=&pendientes_liberar[i];
+		if (pend->soltar_imagen)
+			soltar_imagen(pend->imagen_cache, pend->info_mem);
+		devolver_pila(pend->pila);
+		if (pend->hilo!=NULL)
+			liberar_BCP(pend->hilo);
+		if (pend->proceso!=NULL)
+			liberar_BCP(pend->proceso);
+	}
+#ifdef ESTADISTICAS
+	estadisticas.liberaciones_diferidas+=num_pendientes_liberar;
+	estadisticas.tandas_liberacion++;
+	estadisticas.ciclos_liberacion+=leer_ciclos()-ini;
+#endif
+	num_pendientes_liberar=0;
+}
+
+/*
+ * Deja pendientes de liberar los recursos de un proceso o hilo que
+ * termina. Si ya hay demasiados, se liberan todos.
+ */
+static void anadir_pendiente(liberacion_pendiente *pend){
+	pendientes_liberar[num_pendientes_liberar++]=*pend;
+	if (num_pendientes_liberar>MAX_PENDIENTES_LIBERAR)
+		liberar_pendientes();
+}
+
+/*
+ * Publica en la pagina de datos los contadores del nucleo y, con un
+ * solo procesador, el proceso que va a ejecutar
+ */
+static void actualizar_pagina_datos(BCP * actual){
+	zona_compartida.pagina.ticks=ticks_sistema;
+	zona_compartida.pagina.procesos_vivos=num_procesos_vivos;
+	zona_compartida.pagina.procesos_creados=estadisticas.creaciones;
+	zona_compartida.pagina.cambios_contexto=estadisticas.cambios_contexto;
+	zona_compartida.pagina.ints_reloj=estadisticas.ints_reloj;
+	if (NUM_UCPS==1 && actual!=NULL){
+		zona_compartida.pagina.id_actual=actual->id;
+		zona_compartida.pagina.tiempos_actual=actual->proceso->tiempos;
+	}
+}
+
+/*
+ *
+ * Funciones relacionadas con la planificacion
+ *	espera_int planificador
+ */
+
+#ifdef TICK_DINAMICO
+/*
+ * Programa el reloj para que no interrumpa hasta que venza el primer
+ * plazo (o el siguiente impulso MLFQ). Se llama sin procesos listos y
+ * con las interrupciones de reloj inhibidas.
+ */
+static void omitir_ticks(){
+	unsigned long limite=ticks_sistema+MAX_TICKS_OMITIDOS;
+
+	if (procesos_esperando_plazos.num>0 && procesos_esperando_plazos.procs[0]->plazo<limite)
+		limite=procesos_esperando_plazos.procs[0]->plazo;
+#ifdef MLFQ
+	if (proximo_impulso_mlfq<limite)
+		limite=proximo_impulso_mlfq;
+#endif
+	if (limite<=ticks_sistema+1)
+		return;
+	ticks_por_int_reloj=limite-ticks_sistema;
+	programar_cont_reloj(TICK, ticks_por_int_reloj);
+}
+
+/*
+ * Si la espera la ha interrumpido otro dispositivo antes que el reloj,
+ * contabiliza el tiempo transcurrido y vuelve al reloj periodico.
+ */
+static void reanudar_ticks(unsigned long long inicio_ms){
+	unsigned long transcurridos;
+
+	if (ticks_por_int_reloj==1)
+		return;
+	transcurridos=(leer_reloj_CMOS()-inicio_ms)*TICK/1000;
+	if (transcurridos>=ticks_por_int_reloj)
+		transcurridos=ticks_por_int_reloj-1;
+	ticks_sistema+=transcurridos;
+	estadisticas.ticks_omitidos+=transcurridos;
+	ticks_por_int_reloj=1;
+	programar_cont_reloj(TICK, 1);
+}
+#endif
+
+/*
+ * Espera a que se produzca una interrupcion. Con SMP suelta mientras
+ * tanto el cerrojo del nucleo para que los demas procesadores sigan.
+ */
+static void espera_int(){
+	int nivel;
+#ifdef SMP
+	int prof;
+#endif
+
+	printk("-> NO HAY LISTOS. ESPERA INT\n");
+	liberar_pendientes();	/* aprovecha para liberar terminados */
+
+#ifdef TICK_DINAMICO
+	unsigned long long inicio_ms=leer_reloj_CMOS();
+
+	nivel=fijar_nivel_int(NIVEL_3);
+	omitir_ticks();
+#endif
+	/* Baja al m�nimo el nivel de interrupci�n mientras espera */
+#ifdef TICK_DINAMICO
+	fijar_nivel_int(NIVEL_1);
+#else
+	nivel=fijar_nivel_int(NIVEL_1);
+#endif
+	mi_ucp()->ociosa=1;	/* sus ticks no se cargan a ningun proceso */
+#ifdef SMP
+	prof=soltar_nucleo();
+	halt();
+	retomar_nucleo(prof);
+#else
+	halt();
+#endif
+	mi_ucp()->ociosa=0;
+#ifdef TICK_DINAMICO
+	fijar_nivel_int(NIVEL_3);
+	reanudar_ticks(inicio_ms);
+#endif
+	fijar_nivel_int(nivel);
+}
+
+/*
+ * Numero de procesos listos de un procesador que no estan ejecutando
+ */
+static int listos_en_espera(UCP * ucp){
+	if (ucp->actual!=NULL && ucp->actual->estado==LISTO)
+		return ucp->listos.num_listos-1;
+	return ucp->listos.num_listos;
+}
+
+/*
+ * Devuelve el procesador de una mascara de afinidad con menos listos
+ */
+static int ucp_menos_cargada(unsigned int afinidad){
+	int i, elegida=-1;
+
+	for (i=0; i<NUM_UCPS; i++)
+		if ((afinidad & (1U<<i)) && (elegida==-1 ||
+				tabla_ucps[i].listos.num_listos<tabla_ucps[elegida].listos.num_listos))
+			elegida=i;
+	return elegida;
+}
+
+/*
+ * Pasa un proceso listo que no esta ejecutando a la cola de otro procesador
+ */
+static void migrar(BCP * proc, int destino){
+	eliminar_listo(proc);
+	proc->ucp=destino;
+	insertar_listo(proc);
+}
+
+/*
+ * Devuelve el proceso listo mas prioritario de un procesador que no esta
+ * ejecutando y puede ejecutar en el procesador destino, o NULL si no hay
+ */
+static BCP * buscar_migrable(UCP * origen, int destino){
+	int prio;
+	BCP *proc;
+
+	for (prio=NUM_PRIORIDADES-1; prio>=0; prio--)
+		for (proc=origen->listos.niveles[prio].primero; proc!=NULL; proc=proc->siguiente)
+			if (proc!=origen->actual && (proc->afinidad & (1U<<destino)))
+				return proc;
+	return NULL;
+}
+
+/*
+ * Un procesador sin listos roba, al que tiene mas esperando, el mas
+ * prioritario de los que pueden ejecutar en el. Devuelve 1 si lo consigue.
+ */
+static int robar_listo(){
+	UCP *propia=mi_ucp();
+	BCP *elegido=NULL, *proc;
+	int i, esperando, max_esperando=0;
+
+	for (i=0; i<NUM_UCPS; i++)
+		if (&tabla_ucps[i]!=propia &&
+				(esperando=listos_en_espera(&tabla_ucps[i]))>max_esperando &&
+				(proc=buscar_migrable(&tabla_ucps[i], UCP_ACTUAL))!=NULL){
+			elegido=proc;
+			max_esperando=esperando;
+		}
+	if (elegido==NULL)
+		return 0;
+
+	migrar(elegido, UCP_ACTUAL);
+	propia->robos++;
+	return 1;
+}
+
+/*
+ * Tras dejar listo un proceso avisa con una int. entre procesadores al
+ * suyo, que lo elegira si esta ocioso o expulsara al actual si es menos
+ * prioritario. Si ese procesador no esta ocioso avisa tambien a uno que
+ * lo este, para que se lo robe.
+ */
+static void avisar_ucp(BCP * proc){
+#ifdef SMP
 	int i;
 
-	for (i=0; i<MAX_PROC; i++)
-		tabla_procs[i].estado=NO_USADA;
+	if (proc->ucp!=UCP_ACTUAL)
+		enviar_IPI(proc->ucp);
+	if (tabla_ucps[proc->ucp].ociosa)
+		return;
+	for (i=0; i<NUM_UCPS; i++)
+		if (i!=UCP_ACTUAL && i!=proc->ucp && tabla_ucps[i].ociosa &&
+				(proc->afinidad & (1U<<i))){
+			enviar_IPI(i);
+			return;
+		}
+#endif
+}
+
+#ifdef SMP
+/*
+ * Reparto periodico de los listos, que hace el procesador 0. Si el mas
+ * cargado tiene al menos dos listos mas que el menos cargado, le pasa
+ * uno de los que pueden ejecutar en el: el que lleva mas tiempo sin
+ * ejecutar, que es el que menos pierde al dejar el procesador en que
+ * ejecuto por ultima vez. Se mueve como mucho uno cada vez, de modo
+ * que los procesos tienden a seguir donde estan.
+ */
+static void equilibrar_carga(){
+	UCP *mas=&tabla_ucps[0], *menos=&tabla_ucps[0];
+	BCP *elegido=NULL, *proc;
+	int i, prio, destino;
+
+	for (i=1; i<NUM_UCPS; i++){
+		if (tabla_ucps[i].listos.num_listos>mas->listos.num_listos)
+			mas=&tabla_ucps[i];
+		if (tabla_ucps[i].listos.num_listos<menos->listos.num_listos)
+			menos=&tabla_ucps[i];
+	}
+	if (mas->listos.num_listos-menos->listos.num_listos<2)
+		return;
+
+	destino=menos-tabla_ucps;
+	for (prio=NUM_PRIORIDADES-1; prio>=0; prio--)
+		for (proc=mas->listos.niveles[prio].primero; proc!=NULL; proc=proc->siguiente)
+			if (proc!=mas->actual && (proc->afinidad & (1U<<destino)) &&
+					(elegido==NULL || proc->ultimo_tick<elegido->ultimo_tick))
+				elegido=proc;
+	if (elegido==NULL)
+		return;
+
+	migrar(elegido, destino);
+	menos->migraciones++;
+	avisar_ucp(elegido);
+}
+#endif
+
+/*
+ * Funci�n de planificacion por prioridades. Dentro de cada nivel
+ * los procesos se eligen en orden FIFO. Cada procesador elige de su
+ * cola; si esta vacia intenta robar de las demas.
+ */
+static BCP * planificador(){
+	int prio;
+	BCP *proc;
+	cola_listos *cola=&mi_ucp()->listos;
+#ifdef ESTADISTICAS
+	unsigned long long ini;
+#endif
+
+	while (cola->mapa==0)
+		if (!robar_listo())
+			espera_int();		/* No hay nada que hacer */
+
+#ifdef ESTADISTICAS
+	ini=leer_ciclos();
+#endif
+	prio=prioridad_maxima_lista(cola);
+	proc=cola->niveles[prio].primero;
+#ifdef ESTADISTICAS
+	estadisticas.ciclos_planif[tramo_log2(cola->num_listos)]+=leer_ciclos()-ini;
+	estadisticas.elecciones_planif[tramo_log2(cola->num_listos)]++;
+#endif
+	proc->ultimo_tick=ticks_sistema;
+
+	if (proc->despertado){
+		unsigned long espera=ticks_sistema-proc->instante_despertar;
+
+		proc->despertado=0;
+		estadisticas.despertares++;
+		estadisticas.ticks_espera_despertar+=espera;
+		if (espera>estadisticas.max_espera_despertar)
+			estadisticas.max_espera_despertar=espera;
+	}
+	actualizar_pagina_datos(proc);
+	return proc;
+}
+
+/*
+ * Cambia del proceso saliente al entrante. El coste se mide desde que lo
+ * inicia el saliente hasta que el entrante vuelve de cambio_contexto;
+ * un proceso nuevo empieza en otro sitio y su arranque no se cuenta.
+ */
+static void cambiar_proceso(BCP * saliente, BCP * entrante){
+#ifdef SMP
+	/* puede volver en otro procesador, que tiene el cerrojo del nucleo */
+	int prof=mi_ucp()->prof_nucleo;
+#endif
+
+#ifdef ESTADISTICAS
+	inicio_cambio=leer_ciclos();
+#else
+	inicio_cambio=1;
+#endif
+	cambio_contexto(&saliente->contexto_regs, &entrante->contexto_regs);
+#ifdef SMP
+	mi_ucp()->prof_nucleo=prof;
+#endif
+	if (inicio_cambio){
+#ifdef ESTADISTICAS
+		estadisticas.ciclos_cambio+=leer_ciclos()-inicio_cambio;
+#endif
+		estadisticas.cambios_contexto++;
+		inicio_cambio=0;
+	}
+}
+
+/*
+ * Copia datos del nucleo a una direccion que ha pasado el proceso
+ * actual. Devuelve -1 si es nula. Si no es valida, la excepcion de
+ * memoria que se produce termina el proceso en vez de parar el sistema.
+ */
+static int copiar_a_usuario(void *destino, const void *origen, int tam){
+	volatile char *d=destino;
+	const char *o=origen;
+	int i;
+
+	if (destino==NULL)
+		return -1;
+	mi_ucp()->accediendo_usuario=1;
+	for (i=0; i<tam; i++)
+		d[i]=o[i];
+	mi_ucp()->accediendo_usuario=0;
+	return 0;
+}
+
+/*
+ *
+ * Funciones de la tabla de mutex:
+ *	hash_nombre_mutex buscar_mutex_nombre alta_mutex baja_mutex
+ *	mutex_abierto anadir_mutex_proceso quitar_mutex_proceso
+ *	siguiente_mutex_abierto id_propietario propietario_mutex
+ *	fijar_propietario
+ *
+ * El identificador de un mutex lleva su entrada en la tabla, por lo que
+ * encontrarlo no depende del numero de mutex, y la generacion de la
+ * entrada, que distingue a los sucesivos mutex que la ocupan. Su
+ * propietario esta en la palabra de su entrada en zona_compartida, que
+ * los procesos cambian sin llamar al sistema mientras nadie lo espera.
+ */
+
+/*
+ * Valor hash de un nombre de mutex o de rwlock
+ */
+static unsigned int hash_nombre(const char *nombre){
+	unsigned int h=5381;
+	int i;
+
+	for (i=0; i<MAX_NOM_MUT && nombre[i]!='\0'; i++)
+		h=h*33+(unsigned char)nombre[i];
+	return h;
+}
+
+/*
+ * Lista de la tabla hash que corresponde a un nombre
+ */
+static unsigned int hash_nombre_mutex(const char *nombre){
+	return hash_nombre(nombre)%TAM_HASH_MUTEX;
+}
+
+/*
+ * Devuelve el mutex con ese nombre o NULL si no existe
+ */
+static mutex *buscar_mutex_nombre(const char *nombre){
+	mutex *m;
+
+	for (m=hash_mutex[hash_nombre_mutex(nombre)]; m!=NULL; m=m->siguiente)
+		if (strcmp(m->nombre, nombre)==0)
+			return m;
+	return NULL;
+}
+
+/*
+ * Reserva una entrada de la tabla para un mutex nuevo, sin abrirlo, y
+ * lo anade a la tabla hash. Debe haber entradas libres.
+ */
+static mutex *alta_mutex(const char *nombre, int tipo){
+	mutex *m;
+	unsigned int h;
+	int e;
+
+	if (num_entradas_mutex_libres>0)
+		e=entradas_mutex_libres[--num_entradas_mutex_libres];
+	else
+		e=num_entradas_mutex_usadas++;
+	m=&reserva_mutex[e];
+	strcpy(m->nombre, nombre);
+	m->id=generacion_mutex[e]*NUM_MUT+e;
+	m->tipo=tipo;
+	m->num_procesos_usandolo=0;
+	m->cerrojo=&zona_compartida.cerrojos[e];
+	m->cerrojo->tipo=tipo;
+	m->cerrojo->palabra=0;
+	m->cerrojo->veces=0;
+	m->cerrojo->id=m->id;
+	m->propietario=NULL;
+	m->lista_procesos_lock.primero=NULL;
+	m->lista_procesos_lock.ultimo=NULL;
+	tabla_mutex[e]=m;
+	h=hash_nombre_mutex(nombre);
+	m->siguiente=hash_mutex[h];
+	hash_mutex[h]=m;
+	num_mutex++;
+	return m;
+}
+
+/*
+ * Destruye un mutex que ya no tiene ningun proceso. Su entrada queda
+ * libre con otra generacion, de modo que su identificador deja de valer.
+ */
+static void baja_mutex(mutex *m){
+	mutex **p=&hash_mutex[hash_nombre_mutex(m->nombre)];
+	int e=m->id%NUM_MUT;
+
+	while (*p!=m)
+		p=&(*p)->siguiente;
+	*p=m->siguiente;
+	tabla_mutex[e]=NULL;
+	m->cerrojo->id=-1;
+	generacion_mutex[e]=(generacion_mutex[e]+1)%MAX_GENERACION_MUTEX;
+	entradas_mutex_libres[num_entradas_mutex_libres++]=e;
+	num_mutex--;
+}
+
+/*
+ * Devuelve el mutex con ese identificador si lo tiene abierto el proceso
+ * del hilo actual, o NULL si no
+ */
+static mutex *mutex_abierto(int id){
+	BCP *proceso=p_proc_actual->proceso;
+	mutex *m;
+	int e;
+
+	if (id<0)
+		return NULL;
+	e=id%NUM_MUT;
+	m=tabla_mutex[e];
+	if (m==NULL || m->id!=id ||
+			!(proceso->mutex_abiertos[e/32] & (1U<<(e%32))))
+		return NULL;
+	return m;
+}
+
+static void anadir_mutex_proceso(BCP *proceso, mutex *m){
+	int e=m->id%NUM_MUT;
+
+	proceso->mutex_abiertos[e/32]|=1U<<(e%32);
+	proceso->num_mutex_asignados++;
+	m->num_procesos_usandolo++;
+}
+
+static void quitar_mutex_proceso(BCP *proceso, mutex *m){
+	int e=m->id%NUM_MUT;
+
+	proceso->mutex_abiertos[e/32]&=~(1U<<(e%32));
+	proceso->num_mutex_asignados--;
+	m->num_procesos_usandolo--;
+}
+
+/*
+ * Devuelve el primer bit activo a partir de desde en un mapa de num
+ * bits, o -1 si no hay ninguno
+ */
+static int siguiente_en_mapa(const unsigned int *mapa, int num, int desde){
+	unsigned int palabra;
+	int i=desde/32;
+
+	if (desde>=num)
+		return -1;
+	palabra=mapa[i] & (~0U<<(desde%32));
+	while (palabra==0){
+		if (++i==(num+31)/32)
+			return -1;
+		palabra=mapa[i];
+	}
+	return i*32+__builtin_ctz(palabra);
 }
 
 /*
- * Funci�n que busca una entrada libre en la tabla de procesos
+ * Devuelve la primera entrada a partir de desde de un mutex que tiene
+ * abierto el proceso, o -1 si no hay ninguna
  */
-static int buscar_BCP_libre(){
-	int i;
+static int siguiente_mutex_abierto(BCP *proceso, int desde){
+	return siguiente_en_mapa(proceso->mutex_abiertos, NUM_MUT, desde);
+}
 
-	for (i=0; i<MAX_PROC; i++)
-		if (tabla_procs[i].estado==NO_USADA)
-			return i;
-	return -1;
+/*
+ * Id del propietario de un mutex o -1 si esta libre
+ */
+static int id_propietario(mutex *m){
+	return (int)(m->cerrojo->palabra & ~CERROJO_ESPERAN)-1;
+}
+
+/*
+ * BCP del propietario de un mutex o NULL si esta libre. Si lo cogio sin
+ * llamar al sistema, el nucleo no lo conoce y lo busca por su
+ * identificador con buscar_BCP.
+ */
+static BCP *propietario_mutex(mutex *m){
+	int id=id_propietario(m);
+	BCP *proc=m->propietario;
+
+	if (id<0)
+		return NULL;
+	if (proc==NULL || proc->estado==NO_USADA || proc->id!=id)
+		m->propietario=buscar_BCP(id);
+	return m->propietario;
+}
+
+/*
+ * Deja el mutex al proceso, o libre si es NULL, bloqueado esas veces.
+ * Si quedan procesos esperandolo, la palabra lo indica para que su
+ * propietario llame al sistema al desbloquearlo.
+ */
+static void fijar_propietario(mutex *m, BCP *proc, int veces){
+	unsigned int palabra=0;
+
+	if (proc!=NULL){
+		palabra=CERROJO_DUENO(proc->id);
+		if (m->lista_procesos_lock.primero!=NULL)
+			palabra|=CERROJO_ESPERAN;
+	}
+	m->propietario=proc;
+	m->cerrojo->veces=veces;
+	__atomic_store_n(&m->cerrojo->palabra, palabra, __ATOMIC_RELEASE);
 }
 
 /*
  *
- * Funciones que facilitan el manejo de las listas de BCPs
- *	insertar_ultimo eliminar_primero eliminar_elem
+ * Funciones de la herencia de prioridad de los mutex:
+ *	fijar_heredada heredar_prioridad recalcular_heredada
  *
- * NOTA: PRIMERO SE DEBE LLAMAR A eliminar Y LUEGO A insertar
+ * El propietario de un mutex ejecuta con la mayor prioridad de los que
+ * lo esperan, si es mayor que la suya, para que los de prioridad
+ * intermedia no retrasen indefinidamente a los mas prioritarios.
  */
 
 /*
- * Inserta un BCP al final de la lista.
+ * Cambia la prioridad heredada de un proceso, pasandolo al nivel que le
+ * corresponde si esta listo
  */
-static void insertar_ultimo(lista_BCPs *lista, BCP * proc){
-	if (lista->primero==NULL)
-		lista->primero= proc;
+static void fijar_heredada(BCP * proc, int heredada){
+	int listo=(proc->estado==LISTO);
+
+	if (listo)
+		eliminar_listo(proc);
+	proc->prioridad_heredada=heredada;
+	if (listo){
+		insertar_listo(proc);
+		avisar_ucp(proc);
+	}
+}
+
+/*
+ * Un proceso de esa prioridad va a esperar al mutex: la hereda su
+ * propietario y, si este espera a su vez otro mutex, el propietario de
+ * ese, a lo largo de la cadena
+ */
+static void heredar_prioridad(mutex * m, int prioridad){
+	BCP *proc;
+
+	while (m!=NULL && (proc=propietario_mutex(m))!=NULL &&
+			prioridad_efectiva(proc)<prioridad){
+		fijar_heredada(proc, prioridad);
+		m=(proc->estado==BLOQUEADO) ? proc->mutex_esperado : NULL;
+	}
+}
+
+/*
+ * Recalcula la prioridad que hereda un proceso a partir de los que
+ * esperan los mutex que sigue teniendo. Usada al soltar uno.
+ */
+static void recalcular_heredada(BCP * proc){
+	int heredada=-1, e;
+	mutex *m;
+	BCP *espera;
+
+	for (e=siguiente_mutex_abierto(proc->proceso, 0); e>=0;
+			e=siguiente_mutex_abierto(proc->proceso, e+1)){
+		m=tabla_mutex[e];
+		if (id_propietario(m)!=proc->id)
+			continue;
+		for (espera=m->lista_procesos_lock.primero; espera!=NULL;
+				espera=espera->siguiente)
+			if (prioridad_efectiva(espera)>heredada)
+				heredada=prioridad_efectiva(espera);
+	}
+	if (heredada!=proc->prioridad_heredada)
+		fijar_heredada(proc, heredada);
+}
+
+/*
+ *
+ * Funcion de la deteccion de interbloqueos de los mutex:
+ *	hay_interbloqueo
+ *
+ */
+
+/*
+ * Indica si el proceso actual se interbloquearia al esperar el mutex:
+ * sigue la cadena de propietarios bloqueados y de los mutex que esperan
+ * hasta uno que no espera ninguno (no hay interbloqueo) o hasta el
+ * actual. Como nunca se deja formar un ciclo, la cadena termina y su
+ * longitud acota el recorrido; aun asi, no pasa de MAX_PROC pasos. Cada
+ * paso encuentra el propietario con propietario_mutex, sin recorrer la
+ * tabla de procesos aunque haya cogido el mutex sin llamar al sistema.
+ */
+static int hay_interbloqueo(mutex * m){
+	BCP *proc;
+	int pasos, hay=0;
+#ifdef ESTADISTICAS
+	unsigned long long ini=leer_ciclos();
+#endif
+
+	for (pasos=0; m!=NULL && pasos<MAX_PROC; pasos++){
+		if ((proc=propietario_mutex(m))==NULL)
+			break;
+		if (proc==p_proc_actual){
+			hay=1;
+			break;
+		}
+		m=(proc->estado==BLOQUEADO) ? proc->mutex_esperado : NULL;
+	}
+#ifdef ESTADISTICAS
+	estadisticas.comprobaciones_interbloqueo++;
+	estadisticas.interbloqueos+=hay;
+	estadisticas.mutex_recorridos+=pasos;
+	estadisticas.ciclos_interbloqueo+=leer_ciclos()-ini;
+#endif
+	return hay;
+}
+
+/*
+ *
+ * Funciones que mantienen la relacion entre un proceso y sus hijos:
+ *	anadir_hijo quitar_hijo buscar_hijo abandonar_hijos
+ *
+ * Cada proceso tiene la lista doblemente enlazada de los hijos cuyo
+ * estado no ha recogido, vivos o zombis.
+ *
+ */
+
+/*
+ * Anade un proceso recien creado a la lista de hijos de su padre
+ */
+static void anadir_hijo(BCP * padre, BCP * hijo){
+	hijo->padre=padre;
+	hijo->hermano_ant=NULL;
+	hijo->hermano_sig=padre->primer_hijo;
+	if (padre->primer_hijo!=NULL)
+		padre->primer_hijo->hermano_ant=hijo;
+	padre->primer_hijo=hijo;
+}
+
+/*
+ * Quita un hijo de la lista de su padre
+ */
+static void quitar_hijo(BCP * hijo){
+	if (hijo->hermano_ant!=NULL)
+		hijo->hermano_ant->hermano_sig=hijo->hermano_sig;
 	else
-		lista->ultimo->siguiente=proc;
-	lista->ultimo= proc;
-	proc->siguiente=NULL;
+		hijo->padre->primer_hijo=hijo->hermano_sig;
+	if (hijo->hermano_sig!=NULL)
+		hijo->hermano_sig->hermano_ant=hijo->hermano_ant;
+	hijo->padre=NULL;
 }
 
 /*
- * Elimina el primer BCP de la lista.
+ * Devuelve el hijo de un proceso con un identificador o NULL
  */
-static void eliminar_primero(lista_BCPs *lista){
+static BCP * buscar_hijo(BCP * padre, int id){
+	BCP *hijo;
 
-	if (lista->ultimo==lista->primero)
-		lista->ultimo=NULL;
-	lista->primero=lista->primero->siguiente;
+	for (hijo=padre->primer_hijo; hijo!=NULL; hijo=hijo->hermano_sig)
+		if (hijo->id==id)
+			break;
+	return hijo;
 }
 
 /*
- * Elimina un determinado BCP de la lista.
+ * Un proceso que termina deja a sus hijos sin padre: los zombis se
+ * liberan y los vivos se liberaran al terminar
  */
-static void eliminar_elem(lista_BCPs *lista, BCP * proc){
-	BCP *paux=lista->primero;
+static void abandonar_hijos(BCP * padre){
+	BCP *hijo, *sig;
+
+	for (hijo=padre->primer_hijo; hijo!=NULL; hijo=sig){
+		sig=hijo->hermano_sig;
+		hijo->padre=NULL;
+		if (hijo->estado==ZOMBI)
+			liberar_BCP(hijo);
+	}
+	padre->primer_hijo=NULL;
+}
 
-	if (paux==proc)
+/*
+ *
+ * Funciones auxiliares para bloquear al proceso actual en una lista y
+ * desbloquear a los de una lista:
+ *	bloquear_en despertar_lista despertar_primero
+ *
+ */
+
+/*
+ * Bloquea el proceso actual en una lista y cambia a otro
+ */
+static void bloquear_en(lista_BCPs *lista){
+	int nivel=fijar_nivel_int(NIVEL_3);
+	BCP *p_bloqueado=p_proc_actual;
+
+	eliminar_listo(p_bloqueado);
+	subir_nivel(p_bloqueado);
+	p_bloqueado->estado=BLOQUEADO;
+	insertar_ultimo(lista, p_bloqueado);
+	p_proc_actual=planificador();
+	cambiar_proceso(p_bloqueado, p_proc_actual);
+	fijar_nivel_int(nivel);
+}
+
+/*
+ * Pasa a listos todos los procesos bloqueados en una lista
+ */
+static void despertar_lista(lista_BCPs *lista){
+	int nivel=fijar_nivel_int(NIVEL_3);
+	BCP *proc;
+
+	while ((proc=lista->primero)!=NULL){
 		eliminar_primero(lista);
-	else {
-		for ( ; ((paux) && (paux->siguiente!=proc));
-			paux=paux->siguiente);
-		if (paux) {
-			if (lista->ultimo==paux->siguiente)
-				lista->ultimo=paux;
-			paux->siguiente=paux->siguiente->siguiente;
-		}
+		proc->estado=LISTO;
+		insertar_listo(proc);
+		avisar_ucp(proc);
 	}
+	fijar_nivel_int(nivel);
+}
+
+/*
+ * Pasa a listos el primer proceso bloqueado en una lista, si hay alguno
+ */
+static void despertar_primero(lista_BCPs *lista){
+	int nivel=fijar_nivel_int(NIVEL_3);
+	BCP *proc=lista->primero;
+
+	if (proc!=NULL){
+		eliminar_primero(lista);
+		proc->estado=LISTO;
+		insertar_listo(proc);
+		avisar_ucp(proc);
+	}
+	fijar_nivel_int(nivel);
 }
 
 /*
  *
- * Funciones relacionadas con la planificacion
- *	espera_int planificador
+ * Funciones de la tabla de rwlocks:
+ *	hash_nombre_rw buscar_rw_nombre alta_rw baja_rw rw_abierto
+ *	anadir_rw_proceso quitar_rw_proceso siguiente_rw_abierto
+ *	leyendo_rw marcar_lectura_rw ceder_rwlock soltar_rwlock
+ *	soltar_rw_hilo dejar_rw
+ *
+ * Se identifican, se buscan por nombre y se abren como los mutex, pero
+ * su estado solo lo cambia el nucleo. Al soltar un rwlock, el nucleo se
+ * lo da a los que despierta, que al volver de bloquearse ya lo tienen.
  */
 
 /*
- * Espera a que se produzca una interrupcion
+ * Lista de la tabla hash que corresponde a un nombre
  */
-static void espera_int(){
-	int nivel;
+static unsigned int hash_nombre_rw(const char *nombre){
+	return hash_nombre(nombre)%TAM_HASH_RW;
+}
 
-	printk("-> NO HAY LISTOS. ESPERA INT\n");
+/*
+ * Devuelve el rwlock con ese nombre o NULL si no existe
+ */
+static rwlock *buscar_rw_nombre(const char *nombre){
+	rwlock *rw;
 
-	/* Baja al m�nimo el nivel de interrupci�n mientras espera */
-	nivel=fijar_nivel_int(NIVEL_1);
-	halt();
+	for (rw=hash_rw[hash_nombre_rw(nombre)]; rw!=NULL; rw=rw->siguiente)
+		if (strcmp(rw->nombre, nombre)==0)
+			return rw;
+	return NULL;
+}
+
+/*
+ * Reserva una entrada de la tabla para un rwlock nuevo, sin abrirlo, y
+ * lo anade a la tabla hash. Debe haber entradas libres.
+ */
+static rwlock *alta_rw(const char *nombre, int preferencia){
+	rwlock *rw;
+	unsigned int h;
+	int e;
+
+	if (num_entradas_rw_libres>0)
+		e=entradas_rw_libres[--num_entradas_rw_libres];
+	else
+		e=num_entradas_rw_usadas++;
+	rw=&reserva_rw[e];
+	strcpy(rw->nombre, nombre);
+	rw->id=generacion_rw[e]*NUM_RW+e;
+	rw->preferencia=preferencia;
+	rw->num_procesos_usandolo=0;
+	rw->num_lectores=0;
+	rw->escritor=NULL;
+	rw->lectores_esperando.primero=NULL;
+	rw->lectores_esperando.ultimo=NULL;
+	rw->escritores_esperando.primero=NULL;
+	rw->escritores_esperando.ultimo=NULL;
+	tabla_rw[e]=rw;
+	h=hash_nombre_rw(nombre);
+	rw->siguiente=hash_rw[h];
+	hash_rw[h]=rw;
+	num_rw++;
+	return rw;
+}
+
+/*
+ * Destruye un rwlock que ya no tiene ningun proceso. Su entrada queda
+ * libre con otra generacion, de modo que su identificador deja de valer.
+ */
+static void baja_rw(rwlock *rw){
+	rwlock **p=&hash_rw[hash_nombre_rw(rw->nombre)];
+	int e=rw->id%NUM_RW;
+
+	while (*p!=rw)
+		p=&(*p)->siguiente;
+	*p=rw->siguiente;
+	tabla_rw[e]=NULL;
+	generacion_rw[e]=(generacion_rw[e]+1)%MAX_GENERACION_RW;
+	entradas_rw_libres[num_entradas_rw_libres++]=e;
+	num_rw--;
+}
+
+/*
+ * Devuelve el rwlock con ese identificador si lo tiene abierto el
+ * proceso del hilo actual, o NULL si no
+ */
+static rwlock *rw_abierto(int id){
+	BCP *proceso=p_proc_actual->proceso;
+	rwlock *rw;
+	int e;
+
+	if (id<0)
+		return NULL;
+	e=id%NUM_RW;
+	rw=tabla_rw[e];
+	if (rw==NULL || rw->id!=id ||
+			!(proceso->rw_abiertos[e/32] & (1U<<(e%32))))
+		return NULL;
+	return rw;
+}
+
+static void anadir_rw_proceso(BCP *proceso, rwlock *rw){
+	int e=rw->id%NUM_RW;
+
+	proceso->rw_abiertos[e/32]|=1U<<(e%32);
+	proceso->num_rw_asignados++;
+	rw->num_procesos_usandolo++;
+}
+
+static void quitar_rw_proceso(BCP *proceso, rwlock *rw){
+	int e=rw->id%NUM_RW;
+
+	proceso->rw_abiertos[e/32]&=~(1U<<(e%32));
+	proceso->num_rw_asignados--;
+	rw->num_procesos_usandolo--;
+}
+
+/*
+ * Devuelve la primera entrada a partir de desde de un rwlock que tiene
+ * abierto el proceso, o -1 si no hay ninguna
+ */
+static int siguiente_rw_abierto(BCP *proceso, int desde){
+	return siguiente_en_mapa(proceso->rw_abiertos, NUM_RW, desde);
+}
+
+/*
+ * Indica si el hilo tiene el rwlock para leer
+ */
+static int leyendo_rw(BCP *proc, rwlock *rw){
+	int e=rw->id%NUM_RW;
+
+	return (proc->rw_leyendo[e/32] & (1U<<(e%32)))!=0;
+}
+
+/*
+ * Da el rwlock para leer al hilo (lectura 1) o se lo quita (lectura 0)
+ */
+static void marcar_lectura_rw(BCP *proc, rwlock *rw, int lectura){
+	int e=rw->id%NUM_RW;
+
+	if (lectura){
+		proc->rw_leyendo[e/32]|=1U<<(e%32);
+		if (++rw->num_lectores>estadisticas.max_lectores_rw)
+			estadisticas.max_lectores_rw=rw->num_lectores;
+	}
+	else {
+		proc->rw_leyendo[e/32]&=~(1U<<(e%32));
+		rw->num_lectores--;
+	}
+}
+
+/*
+ * Si ya no lo tiene un escritor, da el rwlock a los que lo esperan: al
+ * primer escritor si lo prefieren los escritores o no espera ningun
+ * lector, cuando no quedan lectores; si no, a todos los lectores que
+ * esperan. Los que lo reciben pasan a listos.
+ */
+static void ceder_rwlock(rwlock *rw){
+	BCP *proc;
+
+	if (rw->escritor!=NULL)
+		return;
+	if (rw->escritores_esperando.primero!=NULL &&
+			(rw->preferencia==PREFERENCIA_ESCRITORES ||
+			 rw->lectores_esperando.primero==NULL)){
+		if (rw->num_lectores==0){
+			rw->escritor=rw->escritores_esperando.primero;
+			despertar_primero(&rw->escritores_esperando);
+		}
+		return;
+	}
+	while ((proc=rw->lectores_esperando.primero)!=NULL){
+		marcar_lectura_rw(proc, rw, 1);
+		despertar_primero(&rw->lectores_esperando);
+	}
+}
+
+/*
+ * Quita el rwlock al hilo, que lo tiene para leer o para escribir, y se
+ * lo da a los que lo esperan si queda libre
+ */
+static void soltar_rwlock(BCP *proc, rwlock *rw){
+	if (rw->escritor==proc)
+		rw->escritor=NULL;
+	else
+		marcar_lectura_rw(proc, rw, 0);
+	if (rw->num_lectores==0)
+		ceder_rwlock(rw);
+}
+
+/*
+ * Pasa a listos los hilos de un proceso bloqueados en una lista
+ */
+static void despertar_hilos_proceso(lista_BCPs *lista, BCP *proceso){
+	int nivel=fijar_nivel_int(NIVEL_3);
+	BCP *proc=lista->primero, *sig;
+
+	for ( ; proc!=NULL; proc=sig){
+		sig=proc->siguiente;
+		if (proc->proceso==proceso){
+			eliminar_elem(lista, proc);
+			proc->estado=LISTO;
+			insertar_listo(proc);
+			avisar_ucp(proc);
+		}
+	}
 	fijar_nivel_int(nivel);
 }
 
 /*
- * Funci�n de planificacion que implementa un algoritmo FIFO.
+ * Suelta los rwlocks que tiene el hilo actual, sin cerrarlos. Usada al
+ * terminar un hilo.
  */
-static BCP * planificador(){
-	while (lista_listos.primero==NULL)
-		espera_int();		/* No hay nada que hacer */
-	return lista_listos.primero;
+static void soltar_rw_hilo(){
+	BCP *proceso=p_proc_actual->proceso;
+	rwlock *rw;
+	int e;
+
+	for (e=siguiente_rw_abierto(proceso, 0); e>=0;
+			e=siguiente_rw_abierto(proceso, e+1)){
+		rw=tabla_rw[e];
+		if (rw->escritor==p_proc_actual || leyendo_rw(p_proc_actual, rw))
+			soltar_rwlock(p_proc_actual, rw);
+	}
+}
+
+/*
+ * Termina de cerrar un rwlock que el proceso ya ha dejado de contar como
+ * abierto: sus hilos dejan de tenerlo y de esperarlo y, si no lo tiene
+ * abierto ningun otro proceso, se destruye y se despierta al primero que
+ * espera para crear uno. Si no, se da a los que lo esperan si queda libre.
+ */
+static void dejar_rw(BCP *proceso, rwlock *rw){
+	int i;
+
+	despertar_hilos_proceso(&rw->lectores_esperando, proceso);
+	despertar_hilos_proceso(&rw->escritores_esperando, proceso);
+	if (rw->escritor!=NULL && rw->escritor->proceso==proceso)
+		rw->escritor=NULL;
+	for (i=0; i<num_entradas_usadas && rw->num_lectores>0; i++)
+		if (tabla_procs[i].estado!=NO_USADA &&
+				tabla_procs[i].proceso==proceso &&
+				leyendo_rw(&tabla_procs[i], rw))
+			marcar_lectura_rw(&tabla_procs[i], rw, 0);
+	if (rw->num_procesos_usandolo==0){
+		baja_rw(rw);
+		despertar_primero(&esperando_rw_libre);
+	}
+	else if (rw->num_lectores==0)
+		ceder_rwlock(rw);
 }
 
+static void soltar_sincronizacion(int ultimo_hilo);
+
 /*
  *
  * Funcion auxiliar que termina proceso actual liberando sus recursos.
  * Usada por llamada terminar_proceso y por rutinas que tratan excepciones
  *
+ * Si es un hilo, o el proceso tiene otros hilos, solo termina el hilo
+ * actual, soltando los mutex y rwlocks que tiene: la imagen y el BCP del
+ * proceso, que guarda lo que comparten sus hilos, se liberan cuando
+ * termina el ultimo, que ademas cierra los que tiene abiertos. Si el proceso tiene
+ * padre, su BCP queda como zombi hasta que este recoja su estado.
+ *
  */
 static void liberar_proceso(){
-	BCP * p_proc_anterior;
+	BCP * proceso=p_proc_actual->proceso;
+	int ultimo_hilo=(--proceso->num_hilos==0);
+	int id_anterior=p_proc_actual->id;
+	liberacion_pendiente pend;
+#ifdef ESTADISTICAS
+	unsigned long long ini=leer_ciclos();
+#endif
 	
-	liberar_imagen(p_proc_actual->info_mem); /* liberar mapa */
+	soltar_sincronizacion(ultimo_hilo);
+	if (ultimo_hilo){
+		abandonar_hijos(proceso);
+		/* el HAL termina el sistema al liberar la ultima imagen */
+		if (--num_procesos_vivos==0){
+#ifdef ESTADISTICAS
+			mostrar_estadisticas();
+#endif
+			liberar_pendientes();
+			soltar_imagen(proceso->imagen_cache, proceso->info_mem);
+			vaciar_cache_imagenes();
+		}
+	}
 
 	p_proc_actual->estado=TERMINADO;
-	eliminar_primero(&lista_listos); /* proc. fuera de listos */
+	eliminar_listo(p_proc_actual); /* proc. fuera de listos */
+
+	/* lo que se liberara despues; se copia ahora porque mientras
+	   espera en el planificador (con SMP) el padre puede recoger y
+	   liberar el zombi */
+	pend.pila=p_proc_actual->pila;
+	pend.hilo=(p_proc_actual!=proceso) ? p_proc_actual : NULL;
+	pend.proceso=(ultimo_hilo && proceso->padre==NULL) ? proceso : NULL;
+	pend.soltar_imagen=ultimo_hilo;
+	pend.imagen_cache=proceso->imagen_cache;
+	pend.info_mem=proceso->info_mem;
+	if (ultimo_hilo && proceso->padre!=NULL){
+		proceso->estado=ZOMBI;
+		despertar_lista(&proceso->padre->esperando_hijos);
+	}
+#ifdef ESTADISTICAS
+	estadisticas.ciclos_terminacion+=leer_ciclos()-ini;
+#endif
 
 	/* Realizar cambio de contexto */
-	p_proc_anterior=p_proc_actual;
 	p_proc_actual=planificador();
 
 	//Inicializamos la rodaja del nuevo proceso en su totalidad
-	p_proc_actual->tiempo_rodaja=TICKS_POR_RODAJA;
+	p_proc_actual->tiempo_rodaja=rodaja_nivel(p_proc_actual);
 
 
 	printk("-> C.CONTEXTO POR FIN: de %d a %d\n",
-			p_proc_anterior->id, p_proc_actual->id);
-
-	liberar_pila(p_proc_anterior->pila);
+			id_anterior, p_proc_actual->id);
+
+	/* no se deja pendiente antes de elegir al siguiente: el planificador
+	   puede esperar en la pila del proceso soltando el cerrojo del
+	   nucleo (con SMP) y otro procesador la liberaria. Desde ahora hasta
+	   el cambio no se libera ni se crea ningun otro. */
+#ifdef ESTADISTICAS
+	ini=leer_ciclos();
+	anadir_pendiente(&pend);
+	estadisticas.ciclos_terminacion+=leer_ciclos()-ini;
+	estadisticas.terminaciones++;
+	inicio_cambio=leer_ciclos();
+#else
+	anadir_pendiente(&pend);
+	inicio_cambio=1;
+#endif
 	cambio_contexto(NULL, &(p_proc_actual->contexto_regs));
-        return; /* no deber�a llegar aqui */
+        return; /* no debe�a llegar aqui */
+}
+
+#ifdef SMP
+/*
+ * Un proceso nuevo empieza en modo usuario sin volver de cambiar_proceso:
+ * suelta el cerrojo del nucleo que tomo quien cambio a el
+ */
+static void arranque_proceso(){
+	inicio_cambio=0;
+	soltar_nucleo();
 }
 
+/*
+ * Contexto propio de cada procesador: espera a tener un proceso y se lo
+ * cede. Se vuelve a el cuando el proceso actual tiene que dejar el
+ * procesador y no hay otro listo al que cambiar.
+ */
+static void bucle_ucp(){
+	int prof;
+
+	for (;;){
+		p_proc_actual=planificador();
+		p_proc_actual->tiempo_rodaja=rodaja_nivel(p_proc_actual);
+		prof=mi_ucp()->prof_nucleo;
+		cambio_contexto(&mi_ucp()->contexto_ocioso, &(p_proc_actual->contexto_regs));
+		mi_ucp()->prof_nucleo=prof;
+	}
+}
+
+/*
+ * Arranque de los procesadores secundarios: cada uno pone en marcha su
+ * reloj y espera a tener un proceso que ejecutar
+ */
+static void arranque_ucp(){
+	entrar_nucleo();
+	iniciar_cont_reloj(TICK);
+	bucle_ucp();
+}
+
+/*
+ * El proceso actual deja este procesador, que no esta en su afinidad:
+ * pasa al procesador permitido menos cargado y cede este a otro listo o,
+ * si no lo hay, al contexto propio del procesador. No puede quedarse
+ * esperando en el planificador, ya que otro procesador lo podria elegir
+ * antes de que se haya salvado su contexto.
+ */
+static void abandonar_ucp(){
+	BCP *saliente=p_proc_actual;
+	int prof;
+
+	migrar(saliente, ucp_menos_cargada(saliente->afinidad));
+	tabla_ucps[saliente->ucp].migraciones++;
+	avisar_ucp(saliente);
+	if (mi_ucp()->listos.mapa!=0 || robar_listo()){
+		p_proc_actual=planificador();
+		p_proc_actual->tiempo_rodaja=rodaja_nivel(p_proc_actual);
+		cambiar_proceso(saliente, p_proc_actual);
+	}
+	else {
+		prof=mi_ucp()->prof_nucleo;
+		p_proc_actual=NULL;
+		cambio_contexto(&saliente->contexto_regs, &mi_ucp()->contexto_ocioso);
+		mi_ucp()->prof_nucleo=prof;
+	}
+}
+#endif
+
 /*
  *
  * Funciones relacionadas con el tratamiento de interrupciones
@@ -176,11 +2015,13 @@ static void liberar_proceso(){
  */
 static void exc_arit(){
 
+	entrar_nucleo();
 	if (!viene_de_modo_usuario())
 		panico("excepcion aritmetica cuando estaba dentro del kernel");
 
 
 	printk("-> EXCEPCION ARITMETICA EN PROC %d\n", p_proc_actual->id);
+	p_proc_actual->proceso->estado_salida=ESTADO_EXCEPCION;
 	liberar_proceso();
 
         return; /* no deber�a llegar aqui */
@@ -191,11 +2032,15 @@ static void exc_arit(){
  */
 static void exc_mem(){
 
-	if (!viene_de_modo_usuario())
+	entrar_nucleo();
+	// En modo sistema solo es del proceso si copiaba a su memoria
+	if (!viene_de_modo_usuario() && !mi_ucp()->accediendo_usuario)
 		panico("excepcion de memoria cuando estaba dentro del kernel");
+	mi_ucp()->accediendo_usuario=0;
 
 
 	printk("-> EXCEPCION DE MEMORIA EN PROC %d\n", p_proc_actual->id);
+	p_proc_actual->proceso->estado_salida=ESTADO_EXCEPCION;
 	liberar_proceso();
 
         return; /* no deber�a llegar aqui */
@@ -207,8 +2052,10 @@ static void exc_mem(){
 static void int_terminal(){
 	char car;
 
+	entrar_nucleo();
 	car = leer_puerto(DIR_TERMINAL);
 	printk("-> TRATANDO INT. DE TERMINAL %c\n", car);
+	salir_nucleo();
 
         return;
 }
@@ -217,58 +2064,128 @@ static void int_terminal(){
  * Tratamiento de interrupciones de reloj
  */
 static void int_reloj(){
+	UCP *ucp;
+	int principal;
 
+	entrar_nucleo();
+	ucp=mi_ucp();
+	principal=(ucp==&tabla_ucps[0]);
 	printk("-> TRATANDO INT. DE RELOJ\n");
-	//Planificacion round robin
-	printk("Proceso actual tiempo rodaja: %d\n", p_proc_actual->tiempo_rodaja);
-	if(p_proc_actual->tiempo_rodaja<=0){
-		//Fija el nivel de interrupcion solo
-		activar_int_SW();
+	// El tiempo del sistema y los plazos los lleva el reloj del procesador 0
+	if(principal){
+		// Con tick dinamico una interrupcion puede representar varios ticks
+		ticks_sistema+=ticks_por_int_reloj;
+		estadisticas.ints_reloj++;
+		estadisticas.ticks_omitidos+=ticks_por_int_reloj-1;
+		ticks_por_int_reloj=1;
+#ifdef MLFQ
+		if (ticks_sistema>=proximo_impulso_mlfq){
+			impulsar_niveles();
+			proximo_impulso_mlfq=ticks_sistema+PERIODO_IMPULSO_MLFQ;
+		}
+#endif
+#ifdef SMP
+		if (PERIODO_EQUILIBRADO>0 && ticks_sistema>=proximo_equilibrado){
+			equilibrar_carga();
+			proximo_equilibrado=ticks_sistema+PERIODO_EQUILIBRADO;
+		}
+#endif
 	}
-	else{
-		//En caso de que no queden mas procesos, el proceso padre de todos no consume la rodaja hasta que no hayan mas procesos en la cola.ls
-		if(lista_listos.primero!=NULL)
-			p_proc_actual->tiempo_rodaja--;
+	if(ucp->ociosa || ucp->actual==NULL)
+		ucp->ticks_ociosa++;
+	else {
+		ucp->ticks_ocupada++;
+		// El tick se carga al proceso en el modo en que se interrumpio
+		if(viene_de_modo_usuario())
+			p_proc_actual->proceso->tiempos.usuario++;
+		else
+			p_proc_actual->proceso->tiempos.sistema++;
 	}
-	//
-
-	BCP * index_lista_bloqueados = lista_procesos_esperando_plazos.primero;
-	while(index_lista_bloqueados != NULL){
-		// Guardamos el proceso siguiente en caso de que se borre el proceso porque haya terminado
-		BCP * proceso_siguiente = index_lista_bloqueados->siguiente;
-		if(index_lista_bloqueados->dormir_t % 100 == 0)
-			printk("Proceso ID(%d): Quedan %d segundos\n", index_lista_bloqueados-> id, index_lista_bloqueados->dormir_t/TICK);
-		
-		if(index_lista_bloqueados->dormir_t <= 0){
-
-			printk("El proceso con id = %d despierta\n", index_lista_bloqueados->id);
-			index_lista_bloqueados->estado = LISTO;
-			eliminar_elem(&lista_procesos_esperando_plazos, index_lista_bloqueados);
-			insertar_ultimo(&lista_listos, index_lista_bloqueados);
+	// Un procesador secundario no tiene proceso hasta que roba el primero
+	if(ucp->actual!=NULL){
+		//Planificacion round robin
+		printk("Proceso actual tiempo rodaja: %d\n", p_proc_actual->tiempo_rodaja);
+		if(p_proc_actual->tiempo_rodaja<=0){
+			//Fija el nivel de interrupcion solo
+			activar_int_SW();
+		}
+		else{
+			//En caso de que no queden mas procesos, el proceso padre de todos no consume la rodaja hasta que no hayan mas procesos en la cola.ls
+			if(ucp->listos.mapa!=0)
+				p_proc_actual->tiempo_rodaja--;
 		}
-		else
-			index_lista_bloqueados->dormir_t--;
-
-		//index_lista_bloqueados = index_lista_bloqueados->siguiente;
-		index_lista_bloqueados = proceso_siguiente;
 	}
-	// Restauramos al nivel previo de la interrupcion 
-	fijar_nivel_int(nivelAnterior);
+	if(principal){
+		//Despertamos solo a los procesos cuyo plazo ha vencido, que estan en la cima del monticulo
+#ifdef ESTADISTICAS
+		int num_dormidos = procesos_esperando_plazos.num;
+		unsigned long long ini = leer_ciclos();
+#endif
+		while(procesos_esperando_plazos.num > 0 && procesos_esperando_plazos.procs[0]->plazo <= ticks_sistema){
+			BCP * proceso_despierto = procesos_esperando_plazos.procs[0];
+			mutex * esperado = proceso_despierto->mutex_esperado;
+
+			eliminar_plazo(proceso_despierto);
+			//Si esperaba un mutex con plazo deja de esperarlo y el
+			//propietario deja de heredar su prioridad
+			if(esperado != NULL){
+				eliminar_elem(&esperado->lista_procesos_lock, proceso_despierto);
+				if(propietario_mutex(esperado) != NULL)
+					recalcular_heredada(propietario_mutex(esperado));
+			}
+			printk("El proceso con id = %d despierta\n", proceso_despierto->id);
+			proceso_despierto->estado = LISTO;
+			proceso_despierto->instante_despertar = ticks_sistema;
+			proceso_despierto->despertado = 1;
+			insertar_listo(proceso_despierto);
+			avisar_ucp(proceso_despierto);
+		}
+#ifdef ESTADISTICAS
+		if(num_dormidos > 0){
+			estadisticas.ciclos_plazos[tramo_log2(num_dormidos)] += leer_ciclos()-ini;
+			estadisticas.ticks_plazos[tramo_log2(num_dormidos)]++;
+		}
+#endif
+	}
+	//Expulsamos al proceso actual si hay listo otro de mayor prioridad
+	if(ucp->actual!=NULL && p_proc_actual->estado==LISTO &&
+			prioridad_maxima_lista(&ucp->listos)>prioridad_efectiva(p_proc_actual))
+		activar_int_SW();
+	actualizar_pagina_datos(ucp->actual);
+	salir_nucleo();
 	return;
 }
 
+#ifdef SMP
+/*
+ * Tratamiento de interrupciones entre procesadores: otro procesador ha
+ * dejado un proceso listo en la cola de este. Si esta ocioso lo elige al
+ * volver a su planificador; si no, expulsa al actual si es menos
+ * prioritario.
+ */
+static void int_ipi(){
+	entrar_nucleo();
+	if(p_proc_actual!=NULL && p_proc_actual->estado==LISTO &&
+			prioridad_maxima_lista(&mi_ucp()->listos)>prioridad_efectiva(p_proc_actual))
+		activar_int_SW();
+	salir_nucleo();
+}
+#endif
+
 /*
  * Tratamiento de llamadas al sistema
  */
 static void tratar_llamsis(){
 	int nserv, res;
 
+	entrar_nucleo();
 	nserv=leer_registro(0);
 	if (nserv<NSERVICIOS)
 		res=(tabla_servicios[nserv].fservicio)();
 	else
 		res=-1;		/* servicio no existente */
 	escribir_registro(0,res);
+	salir_nucleo();
 	return;
 }
 
@@ -278,78 +2195,167 @@ static void tratar_llamsis(){
 
 
 static void int_sw(){
+	BCP* procesoActual;
+
+	entrar_nucleo();
 	printk("-> TRATANDO INT. SW\n");
 	//creado por nosotros
-	BCP* procesoActual;
 	p_proc_actual->estado=LISTO;
 	procesoActual=p_proc_actual;
-	eliminar_primero(&lista_listos);
-	insertar_ultimo(&lista_listos, procesoActual);
+	eliminar_listo(procesoActual);
+	// Si ha agotado su rodaja (y no es una expulsion) baja de nivel
+	if(procesoActual->tiempo_rodaja<=0)
+		bajar_nivel(procesoActual);
+	insertar_listo(procesoActual);
 	p_proc_actual=planificador();
 
-	p_proc_actual->tiempo_rodaja=TICKS_POR_RODAJA;
+	p_proc_actual->tiempo_rodaja=rodaja_nivel(p_proc_actual);
 	
-	cambio_contexto(&procesoActual->contexto_regs, &p_proc_actual->contexto_regs);
+	cambiar_proceso(procesoActual, p_proc_actual);
 	//	
 
+	salir_nucleo();
 	return;
 }
 
+/*
+ * Funcion auxiliar que completa el BCP de un proceso o hilo nuevo, cuya
+ * imagen ya esta en info_mem, y lo pone en la cola de listos
+ */
+static void lanzar_tarea(BCP * p_proc, void *pc_inicial, int prioridad){
+	struct cabecera_pila *cab;
+
+	p_proc->pila=reservar_pila();
+	fijar_contexto_ini(p_proc->info_mem, p_proc->pila, TAM_PILA,
+		pc_inicial,
+		&(p_proc->contexto_regs));
+	cab=(struct cabecera_pila *)p_proc->pila;
+	cab->propietario=CERROJO_DUENO(p_proc->id);
+	cab->mutex_abiertos=p_proc->proceso->mutex_abiertos;
+	p_proc->estado=LISTO;
+	//Creado por nosotros
+	p_proc->prioridad = prioridad;
+	p_proc->prioridad_heredada = -1;
+	p_proc->mutex_esperado = NULL;
+	p_proc->pos_plazo = -1;
+	memset(p_proc->rw_leyendo, 0, sizeof(p_proc->rw_leyendo));
+	p_proc->tiempo_rodaja = rodaja_nivel(p_proc);
+	p_proc->despertado = 0;
+	p_proc->epoca_mlfq = epoca_mlfq;
+	// Hereda la afinidad del creador y empieza en su procesador si puede
+	p_proc->afinidad = p_proc_actual!=NULL ? p_proc_actual->afinidad : TODAS_UCPS;
+	p_proc->ucp = (p_proc->afinidad & (1U<<UCP_ACTUAL)) ?
+		UCP_ACTUAL : ucp_menos_cargada(p_proc->afinidad);
+	p_proc->ultimo_tick = ticks_sistema;
+	//
+
+	/* lo inserta al final de cola de listos */
+	insertar_listo(p_proc);
+	avisar_ucp(p_proc);
+}
+
 /*
  *
- * Funcion auxiliar que crea un proceso reservando sus recursos.
- * Usada por llamada crear_proceso.
+ * Funcion auxiliar que crea hasta n procesos de un programa reservando
+ * sus recursos. La imagen se busca una sola vez: si esta en la cache,
+ * todos comparten la que obtiene el primero. Deja los identificadores
+ * en ids (si no es NULL), que puede ser una direccion del proceso
+ * actual, y devuelve cuantos procesos ha creado. Si no puede dejar
+ * alguno, para y devuelve los creados hasta ese.
+ * Usada por llamadas crear_proceso y crear_procesos.
  *
  */
-static int crear_tarea(char *prog){
+static int crear_tareas(char *prog, int n, int *ids){
 	void * imagen, *pc_inicial;
-	int error=0;
-	int proc;
+	int creados, entrada=-1;
 	BCP *p_proc;
+#ifdef ESTADISTICAS
+	unsigned long long ini=leer_ciclos();
+#endif
+
+	liberar_pendientes();	/* sus pilas y entradas se reutilizan */
+	for (creados=0; creados<n; creados++){
+		p_proc=reservar_BCP();
+		if (p_proc==NULL)
+			break;	/* no hay entrada libre */
+
+		/* A rellenar el BCP ... */
+
+		/* crea la imagen de memoria leyendo ejecutable */
+		if (entrada!=-1){
+			imagen=compartir_imagen(p_proc, entrada, &pc_inicial);
+			estadisticas.imagenes_cache++;
+		}
+		else if ((imagen=obtener_imagen(p_proc, prog, &pc_inicial))==NULL){
+			liberar_BCP(p_proc);
+			break;	/* fallo al crear imagen */
+		}
+		entrada=p_proc->imagen_cache;
 
-	proc=buscar_BCP_libre();
-	if (proc==-1)
-		return -1;	/* no hay entrada libre */
-
-	/* A rellenar el BCP ... */
-	p_proc=&(tabla_procs[proc]);
-
-	/* crea la imagen de memoria leyendo ejecutable */
-	imagen=crear_imagen(prog, &pc_inicial);
-	if (imagen)
-	{
 		p_proc->info_mem=imagen;
-		p_proc->pila=crear_pila(TAM_PILA);
-		fijar_contexto_ini(p_proc->info_mem, p_proc->pila, TAM_PILA,
-			pc_inicial,
-			&(p_proc->contexto_regs));
-		p_proc->id=proc;
-		p_proc->estado=LISTO;
 		//Creado por nosotros
 		p_proc->num_mutex_asignados = 0;
-		p_proc->tiempo_rodaja = TICKS_POR_RODAJA;
+		memset(p_proc->mutex_abiertos, 0, sizeof(p_proc->mutex_abiertos));
+		p_proc->num_rw_asignados = 0;
+		memset(p_proc->rw_abiertos, 0, sizeof(p_proc->rw_abiertos));
+		p_proc->proceso = p_proc;
+		p_proc->num_hilos = 1;
+		p_proc->funcion_hilo = NULL;
+		p_proc->arg_hilo = NULL;
+		p_proc->estado_salida = 0;
+		p_proc->tiempos.usuario = 0;
+		p_proc->tiempos.sistema = 0;
+		p_proc->primer_hijo = NULL;
+		p_proc->esperando_hijos.primero = NULL;
+		p_proc->esperando_hijos.ultimo = NULL;
+		if (p_proc_actual!=NULL)
+			anadir_hijo(p_proc_actual->proceso, p_proc);
+		else
+			p_proc->padre = NULL;
+		num_procesos_vivos++;
 		//
-
-		/* lo inserta al final de cola de listos */
-		insertar_ultimo(&lista_listos, p_proc);
-		error= 0;
+#ifdef MLFQ
+		lanzar_tarea(p_proc, pc_inicial, NUM_PRIORIDADES-1);
+#else
+		lanzar_tarea(p_proc, pc_inicial, PRIORIDAD_DEFECTO);
+#endif
+		if (ids!=NULL && copiar_a_usuario(&ids[creados], &p_proc->id,
+				sizeof(int))<0){
+			creados++;	/* este ya esta creado */
+			break;
+		}
 	}
-	else
-		error= -1; /* fallo al crear imagen */
+	if (creados>0){
+		estadisticas.creaciones+=creados;
+#ifdef ESTADISTICAS
+		estadisticas.ciclos_creacion+=leer_ciclos()-ini;
+#endif
+		actualizar_pagina_datos(p_proc_actual);
+	}
+	return creados;
+}
+
+/*
+ * Crea un solo proceso. Devuelve su identificador o -1 si no ha podido.
+ */
+static int crear_tarea(char *prog){
+	int id;
 
-	return error;
+	return crear_tareas(prog, 1, &id)==1 ? id : -1;
 }
 
 /*
  *
  * Rutinas que llevan a cabo las llamadas al sistema
- *	sis_crear_proceso sis_escribir
+ *	sis_crear_proceso sis_crear_procesos sis_crear_hilo sis_terminar_hilo
+ *	sis_datos_hilo sis_escribir sis_esperar_proceso
  *
  */
 
 /*
  * Tratamiento de llamada al sistema crear_proceso. Llama a la
- * funcion auxiliar crear_tarea sis_terminar_proceso
+ * funcion auxiliar crear_tarea sis_terminar_proceso. Devuelve el
+ * identificador del proceso creado o -1.
  */
 int sis_crear_proceso(){
 	char *prog;
@@ -361,6 +2367,83 @@ int sis_crear_proceso(){
 	return res;
 }
 
+/*
+ * Tratamiento de llamada al sistema crear_procesos. Crea n procesos de
+ * un programa con una sola llamada y deja sus identificadores en ids
+ * (si no es NULL). Devuelve cuantos ha creado, que pueden ser menos de n
+ * si no hay sitio, o -1 si n es negativo.
+ */
+int sis_crear_procesos(){
+	char *prog;
+	int n;
+	int *ids;
+
+	prog=(char *)leer_registro(1);
+	n=(int)leer_registro(2);
+	ids=(int *)leer_registro(3);
+	if (n<0)
+		return -1;
+	printk("-> PROC %d: CREAR %d PROCESOS\n", p_proc_actual->id, n);
+	return crear_tareas(prog, n, ids);
+}
+
+/*
+ * Tratamiento de llamada al sistema crear_hilo. Crea un hilo del proceso
+ * actual, con su propio BCP y pila pero con la imagen y los mutex del
+ * proceso, y con la prioridad del que lo crea. Empieza en pc_inicial,
+ * que es la rutina de arranque de hilos de la biblioteca, y esta obtiene
+ * con datos_hilo la funcion y el argumento. Devuelve el identificador
+ * del hilo o -1 si no hay sitio.
+ */
+int sis_crear_hilo(){
+	void *pc_inicial;
+	BCP *p_proc, *proceso=p_proc_actual->proceso;
+#ifdef ESTADISTICAS
+	unsigned long long ini=leer_ciclos();
+#endif
+
+	printk("-> PROC %d: CREAR HILO\n", p_proc_actual->id);
+	pc_inicial=(void *)leer_registro(1);
+	liberar_pendientes();
+	if ((p_proc=reservar_BCP())==NULL)
+		return -1;	/* no hay entrada libre */
+
+	p_proc->info_mem=proceso->info_mem;
+	p_proc->imagen_cache=proceso->imagen_cache;
+	p_proc->proceso=proceso;
+	proceso->num_hilos++;
+	p_proc->padre=NULL;
+	p_proc->primer_hijo=NULL;
+	p_proc->funcion_hilo=(void *)leer_registro(2);
+	p_proc->arg_hilo=(void *)leer_registro(3);
+	lanzar_tarea(p_proc, pc_inicial, p_proc_actual->prioridad);
+
+#ifdef ESTADISTICAS
+	estadisticas.creaciones_hilos++;
+	estadisticas.ciclos_creacion_hilos+=leer_ciclos()-ini;
+#endif
+	return p_proc->id;
+}
+
+/*
+ * Tratamiento de llamada al sistema datos_hilo, que usa la rutina de
+ * arranque de hilos de la biblioteca. Deja en las direcciones de los
+ * registros 1 y 2 la funcion y el argumento del hilo actual. Devuelve -1
+ * si no es un hilo creado con crear_hilo o si no puede dejarlos.
+ */
+int sis_datos_hilo(){
+	void **funcion=(void **)leer_registro(1);
+	void **arg=(void **)leer_registro(2);
+
+	if (p_proc_actual->funcion_hilo==NULL)
+		return -1;
+	if (copiar_a_usuario(funcion, &p_proc_actual->funcion_hilo,
+			sizeof(void *))<0 ||
+	    copiar_a_usuario(arg, &p_proc_actual->arg_hilo, sizeof(void *))<0)
+		return -1;
+	return 0;
+}
+
 /*
  * Tratamiento de llamada al sistema escribir. Llama simplemente a la
  * funcion de apoyo escribir_ker
@@ -378,40 +2461,104 @@ int sis_escribir()
 }
 
 /*
- * Tratamiento de llamada al sistema terminar_proceso. Llama a la
- * funcion auxiliar liberar_proceso
+ * Funcion auxiliar que termina el hilo actual llamando a liberar_proceso,
+ * que suelta sus mutex y rwlocks y, si es el ultimo del proceso, los
+ * cierra. Usada por llamadas terminar_proceso y terminar_hilo.
  */
-int sis_terminar_proceso(){
-//Creado por nosotros
-	// Entra si hay algun mutex abierto. Elimina siempre el que esta en la posicion 0 porque por dentro se 
-	// actualiza la lista sola.
-	if(p_proc_actual->num_mutex_asignados > 0){
-		for (int i = 0; i < p_proc_actual->num_mutex_asignados;){
-			escribir_registro(1 ,p_proc_actual->lista_mutex[i]);
-			mutex* auxMutex=lista_mutex_global.primero;
-			while(auxMutex!=NULL){
-				if(auxMutex->id==p_proc_actual->lista_mutex[i]){
-					break;
-				}
-				auxMutex=auxMutex->siguiente;
-			}
-			//Desbloqueamos todos los mutex que han sido bloqueados por el proceso que se va a cerrar
-			while(auxMutex->veces_bloqueado>0 && auxMutex!=NULL && auxMutex->id_proceso_propietario == p_proc_actual->id)
-				sis_unlock_mutex();
-			sis_cerrar_mutex();
-		}
-		
-	}
-	printk("-> FIN PROCESO %d\n", p_proc_actual->id);
+static int terminar_actual(){
+	if(p_proc_actual->proceso->num_hilos > 1)
+		printk("-> FIN HILO %d\n", p_proc_actual->id);
+	else
+		printk("-> FIN PROCESO %d\n", p_proc_actual->id);
 	liberar_proceso();
 
     return 0; /* no deber�a llegar aqui */
 }
 
+/*
+ * Tratamiento de llamada al sistema terminar_proceso. Termina con codigo
+ * 0 llamando a la funcion auxiliar terminar_actual. En un proceso con
+ * varios hilos termina solo el que la invoca.
+ */
+int sis_terminar_proceso(){
+	p_proc_actual->proceso->estado_salida=0;
+	return terminar_actual();
+}
+
+/*
+ * Tratamiento de llamada al sistema terminar_proceso_estado. Como
+ * terminar_proceso, pero con el codigo de terminacion que se le pasa.
+ */
+int sis_terminar_proceso_estado(){
+	p_proc_actual->proceso->estado_salida=(int)leer_registro(1);
+	return terminar_actual();
+}
+
+/*
+ * Tratamiento de llamada al sistema terminar_hilo. Termina el hilo
+ * actual y, si es el ultimo, el proceso, como terminar_proceso pero sin
+ * fijar el codigo de terminacion.
+ */
+int sis_terminar_hilo(){
+	return terminar_actual();
+}
+
+/*
+ * Tratamiento de llamada al sistema esperar_proceso. Espera a que
+ * termine un hijo del proceso actual, deja su codigo de terminacion en
+ * estado (si no es NULL) y libera su BCP. Un proceso que termina por
+ * una excepcion tiene codigo ESTADO_EXCEPCION. Devuelve 0 o -1 si no es
+ * un hijo cuyo estado no se haya recogido ya.
+ */
+int sis_esperar_proceso(){
+	int id=(int)leer_registro(1);
+	int *estado=(int *)leer_registro(2);
+	BCP *proceso=p_proc_actual->proceso, *hijo;
+
+	printk("-> PROC %d: ESPERAR PROCESO %d\n", p_proc_actual->id, id);
+	/* otro hilo del proceso puede recogerlo mientras tanto */
+	while ((hijo=buscar_hijo(proceso, id))!=NULL && hijo->estado!=ZOMBI)
+		bloquear_en(&proceso->esperando_hijos);
+	if (hijo==NULL)
+		return -1;
+	if (estado!=NULL)
+		copiar_a_usuario(estado, &hijo->estado_salida, sizeof(int));
+	quitar_hijo(hijo);
+	liberar_BCP(hijo);
+	return 0;
+}
+
+/*
+ * Tratamiento de llamada al sistema tiempos_proceso. Si se le pasa una
+ * direccion, deja en ella los ticks que ha ejecutado el proceso (con
+ * todos sus hilos) en modo usuario y en modo sistema. Devuelve los
+ * ticks transcurridos desde el arranque.
+ */
+int sis_tiempos_proceso(){
+	struct tiempos_ejec *t_ejec=(struct tiempos_ejec *)leer_registro(1);
+
+	printk("-> PROC %d: TIEMPOS PROCESO\n", p_proc_actual->id);
+	if (t_ejec!=NULL)
+		copiar_a_usuario(t_ejec, &p_proc_actual->proceso->tiempos,
+			sizeof(struct tiempos_ejec));
+	return (int)ticks_sistema;
+}
+
+/*
+ * Tratamiento de llamada al sistema pagina_datos. Deja en la direccion
+ * que se le pasa la de la pagina de datos del nucleo.
+ */
+int sis_pagina_datos(){
+	struct datos_nucleo **pagina=(struct datos_nucleo **)leer_registro(1);
+	struct datos_nucleo *dir=&zona_compartida.pagina;
+
+	printk("-> PROC %d: PAGINA DATOS\n", p_proc_actual->id);
+	copiar_a_usuario(pagina, &dir, sizeof(dir));
+	return 0;
+}
+
 int obtener_id_pr(){
-	int id = p_proc_actual->id;
-	printk("ID del proceso actual es: %d\n", id);
-	return id;
+	return p_proc_actual->id;
 }
 
 // Creado por nosotros
@@ -420,367 +2567,556 @@ int obtener_id_pr(){
 int sis_dormir(){
 	// Leemos del registro el valor de segundos a dormir
 	unsigned int segs = leer_registro(1);
+	// Evitamos que la interrupcion de reloj toque las listas mientras las modificamos
+	int nivel = fijar_nivel_int(NIVEL_3);
 	// Eliminamos el proceso de la lista de listos
-	eliminar_primero(&lista_listos);
+	eliminar_listo(p_proc_actual);
+	subir_nivel(p_proc_actual);
 	int id = p_proc_actual->id;
 	printk("Mandando a dormir el proceso ID(%d) %d segundos\n", id ,segs);
-	// Indicamos los TICKS que se ha de dormir el proceso
-	p_proc_actual->dormir_t = segs*TICK;
+	// Indicamos el tick en el que debe despertar el proceso
+	p_proc_actual->plazo = ticks_sistema + segs*TICK;
 	//Cambiamos el estado a BLOQUEADO 
 	p_proc_actual->estado = BLOQUEADO;
 	BCP * p_bloqueado = p_proc_actual;
-	insertar_ultimo(&lista_procesos_esperando_plazos, p_bloqueado);
+	insertar_plazo(p_bloqueado);
 	// Asignamos el siguiente proceso de la lista de listos como como el actual
 	p_proc_actual = planificador();
 	// Cambiamos el contexto para salvar los registros del proceso bloqueado y asignar los del nuevo
-	cambio_contexto(&p_bloqueado->contexto_regs, &p_proc_actual->contexto_regs);
+	cambiar_proceso(p_bloqueado, p_proc_actual);
 
-
-	// Cambiamos el nivel para ejecutar la interrupcion de reloj y guardamos el anterior
-	nivelAnterior =  fijar_nivel_int(NIVEL_3);
-	printk("\nTermina interrupcion de reloj\n");
+	// Restauramos el nivel previo al despertar
+	fijar_nivel_int(nivel);
 
 	return 0;
 }
 
 /*
- * Inserta un mutex al final de la lista.
+ * Tratamiento de llamada al sistema crear_mutex. Crea el mutex y lo deja
+ * abierto por el proceso actual. Devuelve su identificador, -1 si el
+ * proceso ya tiene NUM_MUT_PROC abiertos o -2 si el nombre ya existe.
+ * Si no hay entradas libres en la tabla se bloquea hasta que cerrar_mutex
+ * libere una y lo despierte.
  */
-static void insertar_ultimo_mutex(lista_Mutex* lista, mutex* mutex){
-	if (lista->primero==NULL)
-		lista->primero= mutex;
-	else
-		lista->ultimo->siguiente=mutex;
-	lista->ultimo= mutex;
-	mutex->siguiente=NULL;
+int sis_crear_mutex(){
+	char *nombre=(char*)leer_registro(1);
+	int tipo=(int)leer_registro(2);
+	mutex *m;
+
+	if(p_proc_actual->proceso->num_mutex_asignados == NUM_MUT_PROC){
+		return -1;
+	}
+	// Mientras espera otro proceso puede crear uno con el mismo nombre
+	for (;;){
+		if (buscar_mutex_nombre(nombre)!=NULL){
+			// La entrada libre que le tocaba pasa al siguiente que espera
+			if (num_mutex < NUM_MUT)
+				despertar_primero(&esperando_mutex_libre);
+			return -2;
+		}
+		if (num_mutex < NUM_MUT)
+			break;
+		// Bloquear proceso hasta que haya un hueco en la tabla de mutex
+		bloquear_en(&esperando_mutex_libre);
+	}
+	m=alta_mutex(nombre, tipo);
+	anadir_mutex_proceso(p_proc_actual->proceso, m);
+	return m->id;
 }
 
 /*
- * Elimina el primer mutex de la lista.
+ * Tratamiento de llamada al sistema abrir_mutex. Devuelve el
+ * identificador del mutex con ese nombre, -1 si el proceso ya tiene
+ * NUM_MUT_PROC abiertos o -3 si no existe.
  */
-static void eliminar_primero_mutex(lista_Mutex* lista){
+int sis_abrir_mutex(){
+	char *nombre=(char*)leer_registro(1);
+	BCP *proceso=p_proc_actual->proceso;
+	mutex *m;
 
-	if (lista->ultimo == lista->primero)
-		lista->ultimo=NULL;
-	lista->primero = lista->primero->siguiente;
+	if(proceso->num_mutex_asignados == NUM_MUT_PROC){
+		return -1;
+	}
+	if ((m=buscar_mutex_nombre(nombre))==NULL)
+		return -3;
+	// Si el proceso ya lo habia abierto no se vuelve a contar
+	if (mutex_abierto(m->id)==NULL)
+		anadir_mutex_proceso(proceso, m);
+	return m->id;
 }
 
 /*
- * Elimina un determinado mutex de la lista.
- *
- * ¡ATENCION! Esta funcion esta reutilizada de eliminar_elem().
- * En esta funcion, a la hora de eliminar los mutex, no se libera la memoria correspondiente a ellos
- * pudiendo desembocar en una ocupacion total de la memoria del sistema. 
+ * Funcion auxiliar que cede el procesador (con una int. SW) si el proceso
+ * actual ya no es el mas prioritario, p.ej. al dejar de heredar
  */
-static void eliminar_elem_mutex(lista_Mutex* lista, mutex* mutex_a_eliminar){
-	mutex* maux = lista->primero;
+static void expulsar_si_menos_prioritario(){
+	if(prioridad_maxima_lista(cola_de(p_proc_actual))>prioridad_efectiva(p_proc_actual))
+		activar_int_SW();
+}
 
-	if (maux == mutex_a_eliminar)
-		eliminar_primero_mutex(lista);
+/*
+ * Funcion auxiliar que deja libre un mutex que su propietario ha
+ * desbloqueado del todo. Si hay procesos esperando, se lo cede al
+ * primero, que es el unico que se despierta: al volver de
+ * bloquearMutex ya es el propietario.
+ */
+static void ceder_mutex(mutex* mutexLock){
+	BCP* proceso=mutexLock->lista_procesos_lock.primero;
+	BCP* anterior=propietario_mutex(mutexLock);
+	int nivelAnterior;
+
+	if(proceso==NULL){
+		//Quitamos al propietario que lo tenia bloqueado
+		fijar_propietario(mutexLock, NULL, 0);
+	}
 	else {
-		for ( ; ((maux) && (maux->siguiente!=mutex_a_eliminar)); maux = maux->siguiente);
-		if (maux) {
-			if (lista->ultimo == maux->siguiente)
-				lista->ultimo = maux;
-			maux->siguiente = maux->siguiente->siguiente;
-		}
+		nivelAnterior=fijar_nivel_int(NIVEL_3);
+		eliminar_primero(&mutexLock->lista_procesos_lock);
+		// si lo esperaba con plazo, ya no vence
+		if(proceso->pos_plazo>=0)
+			eliminar_plazo(proceso);
+		fijar_propietario(mutexLock, proceso, 1);
+		// hereda de los que siguen esperando antes de entrar en listos
+		recalcular_heredada(proceso);
+		proceso->estado=LISTO;
+		insertar_listo(proceso);
+		avisar_ucp(proceso);
+		fijar_nivel_int(nivelAnterior);
 	}
+	// el anterior deja de heredar de los que esperaban este mutex
+	if(anterior!=NULL)
+		recalcular_heredada(anterior);
 }
 
-int sis_crear_mutex(){
-	// Comprobar si existen ya mutex con el nombre pasado y si num_mutex == MAX_MUTEX
-	// Si ya no se pueden crear mas mutex, devuelve -1.
-	// Si existe un mutex con el nombre, devuelve -2.
+static void bloquearMutex(mutex* mutexLock, unsigned long plazo);
 
-	mutex *newMutex = (mutex*)malloc(sizeof(mutex));
-	mutex *auxMutex = lista_mutex_global.primero;
+/*
+ * Funcion auxiliar que coge un mutex para lock, trylock y lock_timeout:
+ * si lo tiene otro no espera (espera 0), espera sin limite (espera
+ * negativa) o espera como mucho esos ticks. Devuelve 0, -3 si no lo
+ * tiene abierto, -5 si ya tiene el no recursivo, -7 si esperarlo
+ * cerraria un ciclo de procesos que esperan mutex de otros o -8 si no
+ * lo consigue sin esperar o antes del plazo.
+ */
+static int coger_mutex(int id_mutex, long espera){
+	//Buscamos el mutex en la tabla: debe existir y tenerlo abierto el proceso
+	mutex* mutexLock=mutex_abierto(id_mutex);
+	unsigned long plazo=(espera>0) ? ticks_sistema+espera : 0;
+	unsigned int palabra;
 
-	if(p_proc_actual->num_mutex_asignados == NUM_MUT_PROC){
-		return -1;
+	if(mutexLock==NULL){
+		//Error -3: El mutex no existe
+		return -3;
 	}
-	
-	char* nombre=(char*)leer_registro(1);
-	while(auxMutex != NULL){
-		if(strcmp(auxMutex->nombre, nombre)==0){
-			free(newMutex);
-			return -2;
+	if(id_propietario(mutexLock)==p_proc_actual->id){
+		if(mutexLock->tipo==NO_RECURSIVO){
+			//Error: Ya es propietario del mutex no recursivo a bloquear 
+			return -5;	
 		}
-		auxMutex = auxMutex->siguiente;
-	}
-	//Inicializamos el mutex
-	strcpy(newMutex->nombre, nombre);
-	newMutex->tipo = (int)leer_registro(2);
-	newMutex->estado = DESBLOQUEADO_MUTEX;
-	newMutex->siguiente = NULL;
-	newMutex->num_procesos_usandolo = 0;
-	newMutex->veces_bloqueado=0;
-	newMutex->id_proceso_propietario=-1;
-	newMutex->lista_procesos_lock.primero=NULL;
-	newMutex->lista_procesos_lock.ultimo=NULL;
-	// Para poder bloquear un proceso tenemos que pasar a sis_domir el
-	// valor de cuanto tiempo queremos que duerma. En nuestro caso asignamos 1 seg
-	while(num_mutex == NUM_MUT){
-		// Bloquear proceso 1 seg hasta que haya un hueco en la lista de mutex
-		escribir_registro(1, 1);
-		sis_dormir();
-	}
-	// Asignamos e incrementamos el numero de mutex del sistema
-	newMutex->id = id_mutex++;
-	num_mutex++;
-	//Añadimos a la lista global el nuevo mutex
-	insertar_ultimo_mutex(&lista_mutex_global, newMutex);
-	//Incrementamos las variables de los contadores de mutex tanto de la lista global como de la lista del proceso, además de insertarlo en dicha lista
-	p_proc_actual->lista_mutex[p_proc_actual->num_mutex_asignados] = newMutex->id;
-	p_proc_actual->num_mutex_asignados++;
-	newMutex->num_procesos_usandolo++;
-	return newMutex->id;
-}
-
-int sis_abrir_mutex(){
-	// Añadimos a la lista local de mutex del proceso. 
-	if(p_proc_actual->num_mutex_asignados == NUM_MUT_PROC){
-		return -1;
+		mutexLock->cerrojo->veces++;
+		return 0;
 	}
-	else{
-		char *nombre = (char*)leer_registro(1);
-		mutex *mutexAbrir = lista_mutex_global.primero;
-		while(mutexAbrir != NULL){
-			//Buscamos el mutex en la lista global
-			if(strcmp(mutexAbrir->nombre, nombre) == 0){
-				for (int i = 0; i < p_proc_actual->num_mutex_asignados; i++){
-					//Se comprueba si el proceso habia abierto ya con anterioridad el mutex
-					if(mutexAbrir->id == p_proc_actual->lista_mutex[i])
-						return mutexAbrir->id; // Si ya esta asignado al proceso
-				}
-				//En caso de que no se haya abierto con anterioridad por el proceso, se añade a la lista local del proceso
-				p_proc_actual->lista_mutex[p_proc_actual->num_mutex_asignados] = mutexAbrir->id;
-				mutexAbrir->num_procesos_usandolo++;
-				p_proc_actual->num_mutex_asignados++;
-				return mutexAbrir->id;
+	//Si esta libre lo coge, compitiendo con los procesos que lo cogen sin
+	//llamar al sistema. Si no, marca en la palabra que lo espera y se
+	//bloquea hasta que el que lo tiene se lo ceda al desbloquearlo o
+	//venza el plazo. Al cerrarlo su propietario se despierta a todos y lo
+	//coge el primero.
+	while(id_propietario(mutexLock)!=p_proc_actual->id){
+		palabra=mutexLock->cerrojo->palabra;
+		if(palabra==0){
+			if(__sync_bool_compare_and_swap(&mutexLock->cerrojo->palabra,
+					0, CERROJO_DUENO(p_proc_actual->id))){
+				mutexLock->propietario=p_proc_actual;
+				mutexLock->cerrojo->veces=1;
+				return 0;
 			}
-			mutexAbrir = mutexAbrir->siguiente;	
 		}
-		//Devuelve -3 si el mutex no existe
-		return -3;
+		else if(espera==0 || (plazo>0 && ticks_sistema>=plazo)){
+			//Error -8: Lo tiene otro y no puede esperar mas
+			return -8;
+		}
+		else if(DETECTAR_INTERBLOQUEOS && hay_interbloqueo(mutexLock)){
+			//Error -7: Se interbloquearia
+			return -7;
+		}
+		else if((palabra & CERROJO_ESPERAN) ||
+				__sync_bool_compare_and_swap(&mutexLock->cerrojo->palabra,
+					palabra, palabra|CERROJO_ESPERAN)){
+			bloquearMutex(mutexLock, plazo);
+			//Otro hilo del proceso lo puede haber cerrado mientras
+			if(mutex_abierto(id_mutex)!=mutexLock)
+				return -3;
+		}
 	}
+	return 0;
 }
 
+/*
+ * Tratamiento de llamada al sistema lock. La biblioteca solo la usa si
+ * no ha podido coger el mutex cambiando su palabra: esta ocupado, el
+ * proceso no lo tiene abierto o ya es suyo.
+ */
 int sis_lock_mutex(){
-	int id_mutex= leer_registro(1);
-	//booleano donde 0 no existe y 1 existe
-	int existe=0;
-	//Buscamos si existe o no existe el mutex
-	for (int i = 0; i < p_proc_actual->num_mutex_asignados; i++)
-	{
-		if(id_mutex==p_proc_actual->lista_mutex[i]){
-			existe=1;
-			break;
-		}
-	}
-	if(existe==0){
+	return coger_mutex((int)leer_registro(1), -1);
+}
+
+/*
+ * Tratamiento de llamada al sistema trylock. Como lock, pero si el mutex
+ * lo tiene otro devuelve -8 en vez de esperarlo.
+ */
+int sis_trylock_mutex(){
+	return coger_mutex((int)leer_registro(1), 0);
+}
+
+/*
+ * Tratamiento de llamada al sistema lock_timeout. Como lock, pero espera
+ * el mutex como mucho los ticks del registro 2; si vence el plazo antes
+ * de conseguirlo devuelve -8.
+ */
+int sis_lock_timeout_mutex(){
+	return coger_mutex((int)leer_registro(1),
+		(long)(unsigned int)leer_registro(2));
+}
+
+/*
+ * Tratamiento de llamada al sistema unlock. La biblioteca solo la usa si
+ * hay procesos esperando el mutex o no ha podido soltarlo ella.
+ */
+int sis_unlock_mutex(){
+	int id_mutex=leer_registro(1);
+	mutex* mutexLock=mutex_abierto(id_mutex);
+	int propietario;
+
+	if(mutexLock==NULL){
 		//Error -3: El mutex no existe
 		return -3;
 	}
-	else{
-		mutex* auxMutex=lista_mutex_global.primero;
-		mutex* mutexLock;
-		//Buscamos el mutex en la lista global
-		while(auxMutex!=NULL){
-			if(id_mutex==auxMutex->id){
-				mutexLock=auxMutex;
-				break;
-			}
-			auxMutex=auxMutex->siguiente;
-		}
-		if(mutexLock->tipo==NO_RECURSIVO){
-			if(mutexLock->id_proceso_propietario==p_proc_actual->id){
-				//Error: Ya es propietario del mutex no recursivo a bloquear 
-				return -5;	
-			}
-			//Bloqueamos todo proceso intente acceder a este mutex 
-			while(mutexLock->estado==BLOQUEADO_MUTEX){
-				bloquearMutex(mutexLock);
-				
-			}
-			mutexLock->estado=BLOQUEADO_MUTEX;
-			mutexLock->id_proceso_propietario=p_proc_actual->id;
-			mutexLock->veces_bloqueado=1;
-			return 0;
-		}
-		else{
-			//Bloqueamos todo proceso que este asociado al mutex y no sea el actual
-			while(mutexLock->id_proceso_propietario!=p_proc_actual->id && mutexLock->id_proceso_propietario!=-1){
-				bloquearMutex(mutexLock);
-			}
-			if(mutexLock->estado==DESBLOQUEADO_MUTEX)
-				mutexLock->estado=BLOQUEADO_MUTEX;
-			mutexLock->veces_bloqueado++;
-			mutexLock->id_proceso_propietario=p_proc_actual->id;
+	propietario=id_propietario(mutexLock);
+	if(propietario!=p_proc_actual->id){
+		//Desbloquear un recursivo libre no hace nada
+		if(mutexLock->tipo==RECURSIVO && propietario==-1)
 			return 0;
-		}
+		//Error -6: El proceso no es el propietario del mutex
+		return -6;
 	}
-	
-	
+	if(--mutexLock->cerrojo->veces>0)
+		return 0;
+	ceder_mutex(mutexLock);
+	expulsar_si_menos_prioritario();
+	return 0;
 }
 
-int sis_unlock_mutex(){
-	int id_mutex=leer_registro(1);
-	//0 no existe, 1 existe
-	int existe=0;
-	for (int i = 0; i < p_proc_actual->num_mutex_asignados; i++)
-	{
-		if(id_mutex==p_proc_actual->lista_mutex[i]){
-			existe=1;
-			break;
-		}
+/*
+ * Funcion auxiliar que termina de cerrar un mutex que el proceso actual
+ * ya ha dejado de contar como abierto: despierta a todos los que lo
+ * esperan, lo deja libre si era suyo y, si no lo tiene abierto ningun
+ * proceso, lo destruye y despierta al primero que espera para crear uno.
+ */
+static void dejar_mutex(mutex *auxMutex){
+	int nivel;
+
+	//Buscamos en la lista los procesos bloqueados por el mutex
+	BCP *auxProceso=auxMutex->lista_procesos_lock.primero;
+	//Avanzamos en la lista solo cogiendo el primer proceso
+	nivel=fijar_nivel_int(NIVEL_3);
+	while(auxProceso!=NULL){
+		
+		auxProceso->estado=LISTO;
+		eliminar_primero(&auxMutex->lista_procesos_lock);
+		//Si lo esperaba con plazo, ya no vence
+		if(auxProceso->pos_plazo>=0)
+			eliminar_plazo(auxProceso);
+		insertar_listo(auxProceso);
+		avisar_ucp(auxProceso);
+		auxProceso=auxMutex->lista_procesos_lock.primero;
 	}
-	if(existe==0){
-		//Error -3: El mutex no existe
-		return -3;
+	fijar_nivel_int(nivel);
+	if(id_propietario(auxMutex)==p_proc_actual->id){
+		//Quitamos propietario, ya sin nadie esperando
+		fijar_propietario(auxMutex, NULL, 0);
 	}
-	else{
-		mutex* auxMutex=lista_mutex_global.primero;
-		mutex* mutexLock;
-		while(auxMutex!=NULL){
-			if(id_mutex==auxMutex->id){
-				mutexLock=auxMutex;
-				break;
-			}
-			auxMutex=auxMutex->siguiente;
-		}
-		if(mutexLock->tipo==NO_RECURSIVO){
-			//Comprobamos que el proceso actual es el propietario y que el mutex tiene algun propietario
-			if(mutexLock->id_proceso_propietario==p_proc_actual->id && mutexLock->id_proceso_propietario!=-1){
-				mutexLock->estado=DESBLOQUEADO_MUTEX;
-				//Quitamos al propietario que lo tenia bloqueado
-				mutexLock->id_proceso_propietario=-1;
-				mutexLock->veces_bloqueado=0;
-				if(mutexLock->lista_procesos_lock.primero!=NULL){
-					//Desbloqueamos todos los procesos que se habian quedado esperando en el mutex 
-					while(mutexLock->lista_procesos_lock.primero!=NULL){
-						//Lanzamos una interrupcion de reloj para poder desbloquear a los procesos
-						nivelAnterior=fijar_nivel_int(NIVEL_3);
-						mutexLock->lista_procesos_lock.primero->estado=LISTO;
-						BCP* proceso=mutexLock->lista_procesos_lock.primero;
-						eliminar_primero(&mutexLock->lista_procesos_lock);
-						insertar_ultimo(&lista_listos, proceso);
-						//Volvemos a este nivel
-						fijar_nivel_int(nivelAnterior);
-					}
-				}
-				return 0;
-			}
-			//Error no es el propietario
-			return -6;
-		}
-		else{
-			if(mutexLock->id_proceso_propietario!=p_proc_actual->id && mutexLock->id_proceso_propietario!=-1){
-				//Error -6: El proceso no es el propietario del mutex
-				return -6;
-			}
-			mutexLock->veces_bloqueado--;
-			if(mutexLock->veces_bloqueado==0){
-				mutexLock->estado=DESBLOQUEADO_MUTEX;
-				//Quitamos al propietario que lo tenia bloqueado
-				mutexLock->id_proceso_propietario=-1;
-			}
-			//Comprobamos que el mutex no está bloqueado y que tiene procesos que lo esta usando
-			if(mutexLock->lista_procesos_lock.primero!=NULL&&mutexLock->veces_bloqueado==0){
-				//despertamos a todos los procesos que estaban esperando al lock del mutex
-				while(mutexLock->lista_procesos_lock.primero!=NULL){
-					nivelAnterior=fijar_nivel_int(NIVEL_3);
-					mutexLock->lista_procesos_lock.primero->estado=LISTO;
-					BCP* proceso=mutexLock->lista_procesos_lock.primero;
-					eliminar_primero(&mutexLock->lista_procesos_lock);
-				
-					insertar_ultimo(&lista_listos, proceso);
-					fijar_nivel_int(nivelAnterior);
-				}
-			}
-			return 0;
-		}
+	//En caso de que nadie lo este usando, lo eliminamos de la tabla y
+	//despertamos al primero que espera para crear uno
+	if(auxMutex->num_procesos_usandolo == 0){
+		baja_mutex(auxMutex);
+		despertar_primero(&esperando_mutex_libre);
 	}
 }
 
 int sis_cerrar_mutex(){
 	int idMutexCerrar = leer_registro(1);
+	mutex *auxMutex = mutex_abierto(idMutexCerrar);
 
-	// Eliminado esta a false
-	int eliminado = 0;
+	if(auxMutex == NULL){
+		// No se ha podido eliminar el mutex
+		return -3;
+	}
+	//Lo quitamos de los del proceso y decrementamos el numero de procesos que tienen abierto el mutex
+	quitar_mutex_proceso(p_proc_actual->proceso, auxMutex);
+	dejar_mutex(auxMutex);
+	//Deja de heredar de los que lo esperaban si era el propietario
+	if(p_proc_actual->prioridad_heredada>=0){
+		recalcular_heredada(p_proc_actual);
+		expulsar_si_menos_prioritario();
+	}
+	return 0;
+}
 
-	//Eliminamos el mutex indicado
-	for (int i = 0; i < p_proc_actual->num_mutex_asignados; i++){
-		if(p_proc_actual->lista_mutex[i] == idMutexCerrar){
-			p_proc_actual->lista_mutex[i] = -1;
-			eliminado = 1;
-		}
-		//En caso de que se haya eliminado tenemos que actualizar el array
-		if(eliminado == 1){
-			//Desde el elemento eliminado hasta el penultimo, trasladamos los id's una posicion a la izquierda
-			if(i < p_proc_actual->num_mutex_asignados - 1)
-				p_proc_actual->lista_mutex[i] = p_proc_actual->lista_mutex[i + 1];
-			else
-				p_proc_actual->lista_mutex[i] = -1;
-		}
+/*
+ * Funcion auxiliar que suelta los mutex y rwlocks que tiene el hilo
+ * actual al terminar. Los mutex los suelta del todo aunque los haya
+ * cogido varias veces. Si es el ultimo hilo del proceso, ademas cierra
+ * de una vez todos los que tiene abiertos, despertando a los que los
+ * esperan y, por cada entrada que queda libre, a un proceso que espera
+ * para crear otro. Usada por liberar_proceso, por lo que se hace en
+ * cualquier terminacion, tambien por una excepcion.
+ */
+static void soltar_sincronizacion(int ultimo_hilo){
+	BCP *proceso=p_proc_actual->proceso;
+	mutex *m;
+	int e;
+
+	for (e=siguiente_mutex_abierto(proceso, 0); e>=0;
+			e=siguiente_mutex_abierto(proceso, e+1)){
+		m=tabla_mutex[e];
+		if (id_propietario(m)==p_proc_actual->id)
+			ceder_mutex(m);
+	}
+	soltar_rw_hilo();
+	if (!ultimo_hilo)
+		return;
+	for (e=siguiente_mutex_abierto(proceso, 0); e>=0;
+			e=siguiente_mutex_abierto(proceso, e+1)){
+		tabla_mutex[e]->num_procesos_usandolo--;
+		dejar_mutex(tabla_mutex[e]);
 	}
+	memset(proceso->mutex_abiertos, 0, sizeof(proceso->mutex_abiertos));
+	proceso->num_mutex_asignados=0;
+	for (e=siguiente_rw_abierto(proceso, 0); e>=0;
+			e=siguiente_rw_abierto(proceso, e+1)){
+		tabla_rw[e]->num_procesos_usandolo--;
+		dejar_rw(proceso, tabla_rw[e]);
+	}
+	memset(proceso->rw_abiertos, 0, sizeof(proceso->rw_abiertos));
+	proceso->num_rw_asignados=0;
+}
+/*
+ * Tratamiento de llamada al sistema fijar_prioridad. Cambia la prioridad
+ * del proceso actual y devuelve la que tenia. Como sched_setparam, lo
+ * deja al final de su nuevo nivel: si ya no es el primero de los listos
+ * (hay otro mas prioritario o de su misma prioridad) se activa una
+ * int. SW para ceder el procesador.
+ */
+int sis_fijar_prioridad(){
+	int prioridad=(int)leer_registro(1);
+	int anterior=p_proc_actual->prioridad;
 
-	if(eliminado == 1){
-		//Decrementamos el numero de mutex asignados al proceso
-		p_proc_actual->num_mutex_asignados--;
-		mutex *auxMutex = lista_mutex_global.primero;
-		while(auxMutex != NULL){
-			if(auxMutex->id == idMutexCerrar){
-				//Decrementamos el numero de procesos que tienen abierto el mutex
-				auxMutex->num_procesos_usandolo--;
-				if(auxMutex->id_proceso_propietario==p_proc_actual->id){
-					//Quitamos propietario
-					auxMutex->id_proceso_propietario=-1;
-				}
-				//En caso de que nadie lo este usando, lo eliminamos de la lista global
-				if(auxMutex->num_procesos_usandolo == 0){
-					eliminar_elem_mutex(&lista_mutex_global, auxMutex);
-					num_mutex--;
-				}
-				//Buscamos en la lista los procesos bloqueados por el mutex
-				BCP *auxProceso=auxMutex->lista_procesos_lock.primero;
-				//Avanzamos en la lista solo cogiendo el primer proceso
-				while(auxProceso!=NULL){
-					
-					auxProceso->estado=LISTO;
-					eliminar_primero(&auxMutex->lista_procesos_lock);
-					insertar_ultimo(&lista_listos, auxProceso);
-					auxProceso=auxMutex->lista_procesos_lock.primero;
-				}
-				return 0;
-			}
-			auxMutex = auxMutex->siguiente;
-		}
-		return 0;
-	}else{
-		// No se ha podido eliminar el mutex
-		return -3;
+	if (prioridad<0 || prioridad>=NUM_PRIORIDADES)
+		return -1;
+
+	eliminar_listo(p_proc_actual);
+	p_proc_actual->prioridad=prioridad;
+	insertar_listo(p_proc_actual);
+
+	cola_listos *cola=cola_de(p_proc_actual);
+
+	if (cola->niveles[prioridad_maxima_lista(cola)].primero!=p_proc_actual)
+		activar_int_SW();
+	return anterior;
+}
+
+/*
+ * Tratamiento de llamada al sistema fijar_afinidad. Fija los procesadores
+ * en que puede ejecutar el proceso actual (bit i, procesador i; se
+ * ignoran los que no existen) y devuelve la mascara que tenia, o -1 si
+ * no queda ninguno. Si el procesador en que ejecuta no esta entre ellos,
+ * pasa a otro antes de volver.
+ */
+int sis_fijar_afinidad(){
+	unsigned int afinidad=(unsigned int)leer_registro(1) & TODAS_UCPS;
+	unsigned int anterior=p_proc_actual->afinidad;
+
+	if (afinidad==0)
+		return -1;
+
+	p_proc_actual->afinidad=afinidad;
+#ifdef SMP
+	if (!(afinidad & (1U<<UCP_ACTUAL))){
+		int nivel=fijar_nivel_int(NIVEL_3);
+
+		abandonar_ucp();
+		fijar_nivel_int(nivel);
 	}
+#endif
+	return (int)anterior;
 }
+
 //Funcion auxiliar que usamos en el lock y en el unlock para bloquear un proceso en el mutex que se pasa por parametro
-void bloquearMutex(mutex* mutexLock){
-	nivelAnterior =  fijar_nivel_int(NIVEL_3);
-	eliminar_primero(&lista_listos);
-	int id = p_proc_actual->id;
+//Con plazo distinto de 0 tambien espera ese tick en el monticulo de plazos
+static void bloquearMutex(mutex* mutexLock, unsigned long plazo){
+	int nivelAnterior =  fijar_nivel_int(NIVEL_3);
+	eliminar_listo(p_proc_actual);
+	subir_nivel(p_proc_actual);
 	//Cambiamos el estado a BLOQUEADO 
 	p_proc_actual->estado = BLOQUEADO;
 	BCP * p_bloqueado = p_proc_actual;
 
 	insertar_ultimo(&mutexLock->lista_procesos_lock, p_bloqueado);
+	if (plazo > 0){
+		p_bloqueado->plazo = plazo;
+		insertar_plazo(p_bloqueado);
+	}
+	// El propietario (y los de la cadena) hereda su prioridad
+	p_bloqueado->mutex_esperado = mutexLock;
+	heredar_prioridad(mutexLock, prioridad_efectiva(p_bloqueado));
 	// Asignamos el sieguiente proceso de la lista de listos como como el actual
 	p_proc_actual = planificador();
 	// Cambiamos el contexto para salvar los registros del proceso bloqueado y asignar los del nuevo
-	cambio_contexto(&p_bloqueado->contexto_regs, &p_proc_actual->contexto_regs);
+	cambiar_proceso(p_bloqueado, p_proc_actual);
+	p_bloqueado->mutex_esperado = NULL;
 
 
 	// Cambiamos el nivel para ejecutar la interrupcion de reloj y guardamos el anterior
 	fijar_nivel_int(nivelAnterior);
 }
 
+/*
+ * Tratamiento de llamada al sistema crear_rwlock. Como crear_mutex, pero
+ * con la preferencia (PREFERENCIA_LECTORES o PREFERENCIA_ESCRITORES) en
+ * vez del tipo. Devuelve su identificador, -1 si el proceso ya tiene
+ * NUM_RW_PROC abiertos, -2 si el nombre ya existe o -4 si la preferencia
+ * no es valida. Si no hay entradas libres espera a que cerrar_rwlock
+ * libere una.
+ */
+int sis_crear_rwlock(){
+	char *nombre=(char*)leer_registro(1);
+	int preferencia=(int)leer_registro(2);
+	rwlock *rw;
+
+	if (preferencia!=PREFERENCIA_LECTORES && preferencia!=PREFERENCIA_ESCRITORES)
+		return -4;
+	if (p_proc_actual->proceso->num_rw_asignados==NUM_RW_PROC)
+		return -1;
+	// Mientras espera otro proceso puede crear uno con el mismo nombre
+	for (;;){
+		if (buscar_rw_nombre(nombre)!=NULL){
+			if (num_rw<NUM_RW)
+				despertar_primero(&esperando_rw_libre);
+			return -2;
+		}
+		if (num_rw<NUM_RW)
+			break;
+		bloquear_en(&esperando_rw_libre);
+	}
+	rw=alta_rw(nombre, preferencia);
+	anadir_rw_proceso(p_proc_actual->proceso, rw);
+	return rw->id;
+}
+
+/*
+ * Tratamiento de llamada al sistema abrir_rwlock. Devuelve el
+ * identificador del rwlock con ese nombre, -1 si el proceso ya tiene
+ * NUM_RW_PROC abiertos o -3 si no existe.
+ */
+int sis_abrir_rwlock(){
+	char *nombre=(char*)leer_registro(1);
+	BCP *proceso=p_proc_actual->proceso;
+	rwlock *rw;
+
+	if (proceso->num_rw_asignados==NUM_RW_PROC)
+		return -1;
+	if ((rw=buscar_rw_nombre(nombre))==NULL)
+		return -3;
+	// Si el proceso ya lo habia abierto no se vuelve a contar
+	if (rw_abierto(rw->id)==NULL)
+		anadir_rw_proceso(proceso, rw);
+	return rw->id;
+}
+
+/*
+ * Tratamiento de llamada al sistema rdlock. Coge el rwlock para leer si
+ * no lo tiene un escritor y, cuando prefiere a los escritores, no espera
+ * ninguno; si no, espera en la lista de lectores a que se lo den.
+ * Devuelve 0, -3 si el proceso no lo tiene abierto (o lo cierra mientras
+ * lo espera) o -5 si el hilo ya lo tiene.
+ */
+int sis_rdlock(){
+	rwlock *rw=rw_abierto((int)leer_registro(1));
+
+	if (rw==NULL)
+		return -3;
+	if (rw->escritor==p_proc_actual || leyendo_rw(p_proc_actual, rw))
+		return -5;
+	estadisticas.lecturas_rw++;
+	if (rw->escritor==NULL && (rw->preferencia==PREFERENCIA_LECTORES ||
+			rw->escritores_esperando.primero==NULL)){
+		marcar_lectura_rw(p_proc_actual, rw, 1);
+		return 0;
+	}
+	estadisticas.esperas_lectura_rw++;
+	bloquear_en(&rw->lectores_esperando);
+	return leyendo_rw(p_proc_actual, rw) ? 0 : -3;
+}
+
+/*
+ * Tratamiento de llamada al sistema wrlock. Coge el rwlock para escribir
+ * si no lo tiene nadie; si no, espera en la lista de escritores a que se
+ * lo den. Devuelve lo mismo que rdlock.
+ */
+int sis_wrlock(){
+	rwlock *rw=rw_abierto((int)leer_registro(1));
+
+	if (rw==NULL)
+		return -3;
+	if (rw->escritor==p_proc_actual || leyendo_rw(p_proc_actual, rw))
+		return -5;
+	estadisticas.escrituras_rw++;
+	if (rw->escritor==NULL && rw->num_lectores==0){
+		rw->escritor=p_proc_actual;
+		return 0;
+	}
+	estadisticas.esperas_escritura_rw++;
+	bloquear_en(&rw->escritores_esperando);
+	return rw->escritor==p_proc_actual ? 0 : -3;
+}
+
+/*
+ * Tratamiento de llamada al sistema rwunlock. Suelta el rwlock, que el
+ * hilo tiene para leer o para escribir, y si queda libre se lo da a los
+ * que lo esperan. Devuelve 0, -3 si el proceso no lo tiene abierto o -6
+ * si el hilo no lo tiene.
+ */
+int sis_rwunlock(){
+	rwlock *rw=rw_abierto((int)leer_registro(1));
+
+	if (rw==NULL)
+		return -3;
+	if (rw->escritor!=p_proc_actual && !leyendo_rw(p_proc_actual, rw))
+		return -6;
+	soltar_rwlock(p_proc_actual, rw);
+	expulsar_si_menos_prioritario();
+	return 0;
+}
+
+/*
+ * Tratamiento de llamada al sistema cerrar_rwlock. Los hilos del proceso
+ * dejan de tenerlo y los que lo esperan se despiertan sin conseguirlo.
+ * Si ya no lo tiene abierto ningun proceso, se destruye y se despierta
+ * al primero que espera para crear uno. Devuelve 0 o -3 si el proceso no
+ * lo tiene abierto.
+ */
+int sis_cerrar_rwlock(){
+	rwlock *rw=rw_abierto((int)leer_registro(1));
+	BCP *proceso=p_proc_actual->proceso;
+
+	if (rw==NULL)
+		return -3;
+	quitar_rw_proceso(proceso, rw);
+	dejar_rw(proceso, rw);
+	expulsar_si_menos_prioritario();
+	return 0;
+}
+
 //
 /*
  *
@@ -790,26 +3126,49 @@ void bloquearMutex(mutex* mutexLock){
 int main(){
 	/* se llega con las interrupciones prohibidas */
 
+	entrar_nucleo();
 	instal_man_int(EXC_ARITM, exc_arit); 
 	instal_man_int(EXC_MEM, exc_mem); 
 	instal_man_int(INT_RELOJ, int_reloj); 
 	instal_man_int(INT_TERMINAL, int_terminal); 
 	instal_man_int(LLAM_SIS, tratar_llamsis); 
 	instal_man_int(INT_SW, int_sw); 
+#ifdef SMP
+	instal_man_int(INT_IPI, int_ipi);
+	instal_man_arranque(arranque_proceso);
+#endif
 
 	iniciar_cont_int();		/* inicia cont. interr. */
+	zona_compartida.pagina.num_ucps=NUM_UCPS;
+	zona_compartida.pagina.tam_pila=TAM_PILA;
+	zona_compartida.pagina.num_mut=NUM_MUT;
+#ifdef ESTADISTICAS
+	estadisticas.ciclos_arranque=leer_ciclos();
+	estadisticas.ms_arranque=leer_reloj_CMOS();
+#endif
 	iniciar_cont_reloj(TICK);	/* fija frecuencia del reloj */
 	iniciar_cont_teclado();		/* inici cont. teclado */
 
 	iniciar_tabla_proc();		/* inicia BCPs de tabla de procesos */
+	iniciar_cache_pilas();		/* reserva las primeras pilas */
+	precargar_imagenes();		/* carga los primeros programas */
 
 	/* crea proceso inicial */
 	if (crear_tarea((void *)"init")<0)
 		panico("no encontrado el proceso inicial");
 	
+#ifdef SMP
+	/* arranca los demas procesadores, que esperan al cerrojo del nucleo */
+	iniciar_UCPs(NUM_UCPS, arranque_ucp);
+#endif
+
 	/* activa proceso inicial */
+#ifdef SMP
+	bucle_ucp();
+#else
 	p_proc_actual=planificador();
 	cambio_contexto(NULL, &(p_proc_actual->contexto_regs));
+#endif
 	panico("S.O. reactivado inesperadamente");
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,75 @@
+#!/bin/sh
+#
+# prueba_HAL.sh
+#	Prueba de equivalencia del HAL: ejecuta programas de usuario con el
+#	HAL binario (HAL.o_32/HAL.o_64) y con el de fuente (HAL.c) y compara
+#	las salidas, descartando las lineas que dependen de la temporizacion
+#	(ints. de reloj y de terminal, esperas y estadisticas).
+#
+#	uso: ./prueba_HAL.sh [programa ...]
+#	Por defecto solo se usan programas cuya salida no depende de cuando
+#	llegan las ints. de reloj (p.ej. no prueba_RR1).
+#
+
+PROGRAMAS=${*:-"prueba_RR2 prueba_dormir prueba_mutex1 prueba_mutex2 excep_arit excep_mem"}
+ESPERA=60
+
+ORIGEN=$(cd "$(dirname "$0")" && pwd)
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+cp -r "$ORIGEN/boot" "$ORIGEN/minikernel" "$ORIGEN/usuario" "$DIR"
+cd "$DIR" || exit 1
+
+(cd boot && make >/dev/null) || exit 1
+for hal in binario fuente
+do
+	(cd minikernel && make clean >/dev/null && make HAL=$hal >/dev/null 2>&1) || {
+		echo "Error compilando el sistema con HAL=$hal"; exit 1; }
+	mv minikernel/kernel minikernel/kernel_$hal
+done
+# algunos programas no compilan; se prueban los demas (MAKEFLAGS=-k)
+(cd usuario && make >/dev/null 2>&1)
+
+# el HAL necesita un terminal, por lo que se ejecuta bajo "script"
+ejecutar(){
+	timeout $ESPERA script -qc "./boot/boot minikernel/kernel_$1" /dev/null
+}
+
+filtrar(){
+	tr -d '\r' | grep -v -E 'RELOJ|INT. DE TERMINAL|rodaja|ESPERA INT|INT. SW|Quedan|Termina interrupcion|ciclos|ticks|^$'
+}
+
+fallos=0
+for prog in $PROGRAMAS
+do
+	cat > usuario/init.c <<FIN
+#include "servicios.h"
+
+int main(){
+	printf("init: comienza\n");
+	if (crear_proceso("$prog")<0)
+		printf("Error creando $prog\n");
+	printf("init: termina\n");
+	return 0;
+}
+FIN
+	if [ ! -f usuario/$prog ] || ! (cd usuario && make init >/dev/null 2>&1)
+	then
+		echo "$prog: error de compilacion"; fallos=$((fallos+1)); continue
+	fi
+
+	for hal in binario fuente
+	do
+		ejecutar $hal < /dev/null 2>&1 | filtrar > salida_$hal
+	done
+	if diff -u salida_binario salida_fuente > diferencias
+	then
+		echo "$prog: iguales ($(wc -l < salida_fuente) lineas)"
+	else
+		echo "$prog: DIFERENTES"
+		head -20 diferencias
+		fallos=$((fallos+1))
+	fi
+done
+
+exit $fallos
@@ -0,0 +1,55 @@
+#!/bin/sh
+#
+# prueba_equilibrado.sh
+#	Compara el nucleo multiprocesador (-DSMP) con y sin el reparto
+#	periodico de listos: ejecuta prueba_equilibrado en ambos casos y
+#	muestra el tiempo total y, por cada procesador, los ticks que ha
+#	estado ocupado, los robos y las migraciones.
+#
+#	uso: ./prueba_equilibrado.sh [num_procesadores]
+#	Cada procesador virtual es un hilo, por lo que el tiempo depende de
+#	los procesadores reales de la maquina (nproc).
+#
+
+UCPS=${1:-4}
+ESPERA=120
+
+ORIGEN=$(cd "$(dirname "$0")" && pwd)
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+cp -r "$ORIGEN/boot" "$ORIGEN/minikernel" "$ORIGEN/usuario" "$DIR"
+cd "$DIR" || exit 1
+
+cat > usuario/init.c <<FIN
+#include "servicios.h"
+
+int main(){
+	if (crear_proceso("prueba_equilibrado")<0)
+		printf("Error creando prueba_equilibrado\n");
+	return 0;
+}
+FIN
+(cd boot && make >/dev/null) || exit 1
+# algunos programas no compilan; se usan los demas (MAKEFLAGS=-k)
+(cd usuario && make clean >/dev/null && make MISC=fuente >/dev/null 2>&1)
+[ -f usuario/prueba_equilibrado ] || { echo "Error compilando prueba_equilibrado"; exit 1; }
+
+echo "procesadores reales: $(nproc), virtuales: $UCPS"
+for reparto in con sin
+do
+	opciones="-DSMP -DNUM_UCPS=$UCPS -DESTADISTICAS"
+	[ $reparto = sin ] && opciones="$opciones -DPERIODO_EQUILIBRADO=0"
+	(cd minikernel && make clean >/dev/null &&
+		make OPCIONES="$opciones" >/dev/null 2>&1) || {
+		echo "Error compilando el sistema $reparto reparto"; exit 1; }
+	# el HAL necesita un terminal, por lo que se ejecuta bajo "script"
+	timeout $ESPERA script -qc "./boot/boot minikernel/kernel" /dev/null \
+		< /dev/null 2>&1 | tr -d '\r' > salida
+	ms=$(sed -n 's/.*tiempo total: \([0-9]*\) ms.*/\1/p' salida)
+	if [ -z "$ms" ]
+	then
+		echo "$reparto reparto: no ha terminado"; continue
+	fi
+	echo "$reparto reparto: $ms ms"
+	grep '   UCP ' salida
+done
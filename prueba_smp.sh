@@ -0,0 +1,55 @@
+#!/bin/sh
+#
+# prueba_smp.sh
+#	Mide como escala el nucleo multiprocesador (-DSMP) con procesos que
+#	solo gastan CPU: ejecuta prueba_smp con distinto numero de
+#	procesadores virtuales y muestra el tiempo total, la aceleracion
+#	respecto a uno solo y lo que ha hecho cada procesador.
+#
+#	uso: ./prueba_smp.sh [num_procesadores ...]
+#	Cada procesador virtual es un hilo, por lo que la aceleracion esta
+#	limitada por los procesadores reales de la maquina (nproc).
+#
+
+UCPS=${*:-"1 2 4"}
+ESPERA=120
+
+ORIGEN=$(cd "$(dirname "$0")" && pwd)
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+cp -r "$ORIGEN/boot" "$ORIGEN/minikernel" "$ORIGEN/usuario" "$DIR"
+cd "$DIR" || exit 1
+
+cat > usuario/init.c <<FIN
+#include "servicios.h"
+
+int main(){
+	if (crear_proceso("prueba_smp")<0)
+		printf("Error creando prueba_smp\n");
+	return 0;
+}
+FIN
+(cd boot && make >/dev/null) || exit 1
+# algunos programas no compilan; se usan los demas (MAKEFLAGS=-k)
+(cd usuario && make clean >/dev/null && make MISC=fuente >/dev/null 2>&1)
+[ -f usuario/prueba_smp ] || { echo "Error compilando prueba_smp"; exit 1; }
+
+echo "procesadores reales: $(nproc)"
+base=
+for n in $UCPS
+do
+	(cd minikernel && make clean >/dev/null &&
+		make OPCIONES="-DSMP -DNUM_UCPS=$n -DESTADISTICAS" >/dev/null 2>&1) || {
+		echo "Error compilando el sistema con $n procesadores"; exit 1; }
+	# el HAL necesita un terminal, por lo que se ejecuta bajo "script"
+	timeout $ESPERA script -qc "./boot/boot minikernel/kernel" /dev/null \
+		< /dev/null 2>&1 | tr -d '\r' > salida
+	ms=$(sed -n 's/.*tiempo total: \([0-9]*\) ms.*/\1/p' salida)
+	if [ -z "$ms" ]
+	then
+		echo "$n procesadores: no ha terminado"; continue
+	fi
+	[ -z "$base" ] && base=$ms
+	echo "$n procesadores: $ms ms (aceleracion x$(awk "BEGIN{printf \"%.2f\", $base/$ms}"))"
+	grep '   UCP ' salida
+done
@@ -0,0 +1,29 @@
+/*
+ * usuario/alternador.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que escribe un mensaje por vuelta y cede el
+ * procesador fijando la prioridad que ya tiene, lo que lo pone detrs
+ * de los dems procesos de su nivel. Lo usa prueba_ceder.
+ */
+
+#include "servicios.h"
+
+#define VUELTAS 3
+
+int main(){
+	int i, id=obtener_id_pr();
+
+	for (i=0; i<VUELTAS; i++){
+		printf("alternador (%d): vuelta %d\n", id, i);
+		fijar_prioridad(PRIORIDAD_DEFECTO);
+	}
+	printf("alternador (%d): termina\n", id);
+	return 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * usuario/anclado.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que "gasta CPU" anclado al ltimo procesador.
+ * Averigua cuntos hay con la mscara que le devuelve fijar_afinidad al
+ * permitirle todos y despus se restringe al de mayor nmero, por lo que
+ * si estaba ejecutando en otro tiene que migrar.
+ */
+
+#include "servicios.h"
+
+#define TOT_ITER 20000000	/* ponga las que considere oportuno */
+
+int main(){
+	int i, tot;
+	int j=5;
+	unsigned int todas, ultima;
+
+	todas=fijar_afinidad(~0U);
+	ultima=1;
+	while (todas>>1 >= ultima)
+		ultima<<=1;
+	if (fijar_afinidad(ultima)<0)
+		printf("anclado (%d): error fijando afinidad\n", obtener_id_pr());
+
+	for (i=0; i<TOT_ITER; i++)
+		tot=j*i;
+	printf("anclado (%d): termina\n", obtener_id_pr());
+	tot--;
+	return 0;
+}
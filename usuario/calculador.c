@@ -0,0 +1,28 @@
+/*
+ * usuario/calculador.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que "gasta CPU" durante varias rodajas sin hacer
+ * llamadas al sistema. Lo usa prueba_mlfq.
+ */
+
+#include "servicios.h"
+
+#define TOT_ITER 400000000	/* ponga las que considere oportuno */
+
+int main(){
+	int i, tot;
+	int j=5;
+
+	for (i=0; i<TOT_ITER; i++)
+		tot=j*i;
+	printf("calculador (%d): termina\n", obtener_id_pr());
+	tot--;
+	return 0;
+}
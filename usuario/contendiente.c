@@ -0,0 +1,49 @@
+/*
+ * usuario/contendiente.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que compite por el mutex "cont": lo bloquea
+ * ITERACIONES veces, haciendo cada vez una seccin crtica larga, para
+ * que la rodaja le venza a menudo con el mutex bloqueado. Lo usa
+ * prueba_contencion.
+ */
+
+#include "servicios.h"
+
+#define ITERACIONES 20
+#define TRABAJO_DENTRO 4000000
+#define TRABAJO_FUERA 1000
+
+static volatile int basura;
+
+static void trabajar(int n){
+	int i;
+
+	for (i=0; i<n; i++)
+		basura+=i;
+}
+
+int main(){
+	int desc, i;
+
+	if ((desc=abrir_mutex("cont"))<0){
+		printf("contendiente: error abriendo cont\n");
+		return 1;
+	}
+	for (i=0; i<ITERACIONES; i++){
+		if (lock(desc)<0)
+			printf("contendiente: error en lock\n");
+		trabajar(TRABAJO_DENTRO);
+		if (unlock(desc)<0)
+			printf("contendiente: error en unlock\n");
+		trabajar(TRABAJO_FUERA);
+	}
+	cerrar_mutex(desc);
+	return 0;
+}
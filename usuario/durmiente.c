@@ -0,0 +1,26 @@
+/*
+ * usuario/durmiente.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que duerme varias veces un nmero de segundos
+ * que depende de su identificador. Lo usa prueba_plazos.
+ */
+
+#include "servicios.h"
+
+#define NUM_SIESTAS 3	/* ponga las que considere oportuno */
+
+int main(){
+	int i, id;
+
+	id=obtener_id_pr();
+	for (i=0; i<NUM_SIESTAS; i++)
+		dormir(1+(id+i)%3);
+	return 0;
+}
@@ -0,0 +1,20 @@
+/*
+ * usuario/efimero.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que solo imprime su identificador y termina.
+ * Lo usa prueba_tabla.
+ */
+
+#include "servicios.h"
+
+int main(){
+	printf("efimero (%d): termina\n", obtener_id_pr());
+	return 0;
+}
@@ -0,0 +1,30 @@
+/*
+ * usuario/girador.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que "gasta CPU" con una prioridad que depende
+ * de su identificador. Lo usa prueba_planif.
+ */
+
+#include "servicios.h"
+
+#define TOT_ITER 2000000	/* ponga las que considere oportuno */
+
+int main(){
+	int i, tot, id;
+	int j=5;
+
+	id=obtener_id_pr();
+	fijar_prioridad(id%NUM_PRIORIDADES);
+
+	for (i=0; i<TOT_ITER; i++)
+		tot=j*i;
+	tot--;
+	return 0;
+}
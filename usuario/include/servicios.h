@@ -22,6 +22,53 @@
 // Creado por nosotros
 #define NO_RECURSIVO 0
 #define RECURSIVO 1
+// A quien se da un rwlock que esperan lectores y escritores
+#define PREFERENCIA_LECTORES 0
+#define PREFERENCIA_ESCRITORES 1
+// Prioridades de los procesos (mayor valor, mayor prioridad)
+#define NUM_PRIORIDADES 32
+#define PRIORIDAD_DEFECTO 15
+// Codigo de terminacion de un proceso que termina por una excepcion
+#define ESTADO_EXCEPCION (-1)
+// Ticks que ha ejecutado el proceso en modo usuario y en modo sistema
+struct tiempos_ejec {
+	int usuario;
+	int sistema;
+};
+// Estado de un mutex que comparten el nucleo y los procesos, que lo
+// bloquean y desbloquean sin llamar al sistema si nadie lo espera: la
+// palabra es 0 si esta libre o el id del propietario mas 1, con
+// CERROJO_ESPERAN si hay procesos bloqueados esperandolo.
+#define CERROJO_ESPERAN 0x80000000U
+struct cerrojo_mutex {
+	int id;			/* mutex que ocupa la entrada o -1 */
+	int tipo;
+	unsigned int palabra;
+	int veces;		/* veces que lo ha bloqueado su propietario */
+} __attribute__((aligned(64)));
+// Cabecera que el nucleo pone al principio de la pila de cada hilo,
+// alineada a su tamano, para que el hilo sepa quien es sin preguntarlo
+struct cabecera_pila {
+	unsigned int propietario;	/* lo que pone en la palabra de un mutex */
+	const unsigned int *mutex_abiertos; /* mapa de los de su proceso */
+	void *reserva;			/* memoria de la que sale la pila */
+};
+// Pagina de datos del nucleo, que se lee sin hacer llamadas al sistema.
+// El proceso en ejecucion y sus tiempos solo valen con un procesador.
+// El nucleo no la protege, pero no se debe escribir en ella. Justo
+// detras estan las num_mut entradas de los mutex (struct cerrojo_mutex).
+struct datos_nucleo {
+	unsigned long ticks;		/* ticks desde el arranque */
+	int num_ucps;
+	int id_actual;			/* proceso en ejecucion */
+	struct tiempos_ejec tiempos_actual; /* sus ticks de usuario y sistema */
+	int procesos_vivos;
+	unsigned long procesos_creados;
+	unsigned long cambios_contexto;
+	unsigned long ints_reloj;	/* ints. de reloj recibidas */
+	int tam_pila;			/* tamano y alineamiento de las pilas */
+	int num_mut;			/* entradas de la tabla de mutex */
+} __attribute__((aligned(64)));
 //
 
 /* Evita el uso del printf de la bilioteca est�ndar */
@@ -40,8 +87,32 @@ int dormir(unsigned int segs);
 int crear_mutex(char* nombre, int tipo);
 int abrir_mutex(char* nombre);
 int lock(unsigned int mutex_id);
+/* trylock no espera si el mutex lo tiene otro y lock_timeout lo espera
+   como mucho esos ticks: en ambos casos devuelven -8 si no lo consiguen */
+int trylock(unsigned int mutex_id);
+int lock_timeout(unsigned int mutex_id, unsigned int ticks);
 int unlock(unsigned int mutex_id);
 int cerrar_mutex(unsigned int mutex_id);
+/* rwlocks: los tienen a la vez varios hilos con rdlock o uno solo con
+   wrlock, y se sueltan con rwunlock. Devuelven los mismos errores que
+   las llamadas de mutex; crear_rwlock, -4 si la preferencia no vale */
+int crear_rwlock(char *nombre, int preferencia);
+int abrir_rwlock(char *nombre);
+int rdlock(unsigned int rw_id);
+int wrlock(unsigned int rw_id);
+int rwunlock(unsigned int rw_id);
+int cerrar_rwlock(unsigned int rw_id);
+int fijar_prioridad(unsigned int prioridad);
+int fijar_afinidad(unsigned int afinidad);
+int crear_procesos(char *prog, int n, int *ids);
+int crear_hilo(void (*funcion)(void *), void *arg);
+int terminar_hilo();
+int esperar_proceso(int id, int *estado);
+/* como terminar_proceso (que termina con 0), pero con un cdigo que el
+   padre obtiene con esperar_proceso */
+int terminar_proceso_estado(int estado);
+int tiempos_proceso(struct tiempos_ejec *t_ejec);
+const volatile struct datos_nucleo *pagina_datos();
 //
 
 
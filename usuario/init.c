@@ -84,6 +84,116 @@ ALGO COMENTE ESTA PARTE Y DESCOMENTE LA PRUEBA CORRESPONDIENTE */
 		printf("Error creando prueba_RR2\n");
 */
 
+/* PRUEBA DE PRIORIDADES: COSTE DEL PLANIFICADOR CON MUCHOS LISTOS
+	if (crear_proceso("prueba_planif")<0)
+		printf("Error creando prueba_planif\n");
+*/
+
+/* PRUEBA DE CUANDO CEDE EL PROCESADOR FIJAR_PRIORIDAD
+	if (crear_proceso("prueba_ceder")<0)
+		printf("Error creando prueba_ceder\n");
+*/
+
+/* PRUEBA DE MLFQ: COMPARAR CON Y SIN OPCIONES=-DMLFQ EN EL NUCLEO
+	if (crear_proceso("prueba_mlfq")<0)
+		printf("Error creando prueba_mlfq\n");
+*/
+
+/* PRUEBA DE PLAZOS: MUCHOS PROCESOS DORMIDOS A LA VEZ
+	if (crear_proceso("prueba_plazos")<0)
+		printf("Error creando prueba_plazos\n");
+*/
+
+/* PRUEBA DE CAMBIO DE CONTEXTO: COMPARAR HAL BINARIO Y make HAL=fuente
+	if (crear_proceso("prueba_cambios")<0)
+		printf("Error creando prueba_cambios\n");
+*/
+
+/* PRUEBA DEL MULTIPROCESADOR: OPCIONES="-DSMP -DNUM_UCPS=n" Y make MISC=fuente
+	if (crear_proceso("prueba_smp")<0)
+		printf("Error creando prueba_smp\n");
+*/
+
+/* PRUEBA DEL REPARTO DE CARGA: OPCIONES="-DSMP -DNUM_UCPS=n" Y make MISC=fuente
+	if (crear_proceso("prueba_equilibrado")<0)
+		printf("Error creando prueba_equilibrado\n");
+*/
+
+/* PRUEBA DE LA TABLA DE PROCESOS
+	if (crear_proceso("prueba_tabla")<0)
+		printf("Error creando prueba_tabla\n");
+*/
+
+/* PRUEBA DE CREACION Y TERMINACION DE PROCESOS
+	if (crear_proceso("prueba_creacion")<0)
+		printf("Error creando prueba_creacion\n");
+*/
+
+/* PRUEBA DE CREACION DE PROCESOS EN LOTES
+	if (crear_proceso("prueba_lotes")<0)
+		printf("Error creando prueba_lotes\n");
+*/
+
+/* PRUEBA DE HILOS
+	if (crear_proceso("prueba_hilos")<0)
+		printf("Error creando prueba_hilos\n");
+*/
+
+/* PRUEBA DE ESPERA POR LOS HIJOS
+	if (crear_proceso("prueba_esperar")<0)
+		printf("Error creando prueba_esperar\n");
+*/
+
+/* PRUEBA DE LA PAGINA DE DATOS DEL NUCLEO
+	if (crear_proceso("prueba_pagina")<0)
+		printf("Error creando prueba_pagina\n");
+*/
+
+/* PRUEBA DEL TICK DINAMICO (compilar con OPCIONES=-DTICK_DINAMICO)
+	if (crear_proceso("prueba_tick_dinamico")<0)
+		printf("Error creando prueba_tick_dinamico\n");
+*/
+
+/* PRUEBA DEL COSTE DE LOS MUTEX SEGUN CUANTOS HAY ABIERTOS
+	if (crear_proceso("prueba_tabla_mutex")<0)
+		printf("Error creando prueba_tabla_mutex\n");
+*/
+
+/* PRUEBA DE UN MUTEX MUY DISPUTADO
+	if (crear_proceso("prueba_contencion")<0)
+		printf("Error creando prueba_contencion\n");
+*/
+
+/* PRUEBA DE LA HERENCIA DE PRIORIDAD DE LOS MUTEX
+	if (crear_proceso("prueba_inversion")<0)
+		printf("Error creando prueba_inversion\n");
+*/
+
+/* PRUEBA DE LOCK Y UNLOCK SIN LLAMAR AL SISTEMA
+	if (crear_proceso("prueba_cerrojo")<0)
+		printf("Error creando prueba_cerrojo\n");
+*/
+
+/* PRUEBA DE CREAR UN MUTEX CON LA TABLA LLENA
+	if (crear_proceso("prueba_hueco_mutex")<0)
+		printf("Error creando prueba_hueco_mutex\n");
+*/
+
+/* PRUEBA DE LA DETECCION DE INTERBLOQUEOS
+	if (crear_proceso("prueba_interbloqueo")<0)
+		printf("Error creando prueba_interbloqueo\n");
+*/
+
+/* PRUEBA DE TRYLOCK Y LOCK_TIMEOUT CON CARGA
+	if (crear_proceso("prueba_plazo_mutex")<0)
+		printf("Error creando prueba_plazo_mutex\n");
+*/
+
+/* PRUEBA DE RWLOCKS Y DE COMO ESCALAN LAS LECTURAS
+	if (crear_proceso("prueba_rwlock")<0)
+		printf("Error creando prueba_rwlock\n");
+*/
+
 /* PRUEBA DEL TERMINAL
 	if (crear_proceso("prueba_term")<0)
 		printf("Error creando prueba_term\n");
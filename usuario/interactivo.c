@@ -0,0 +1,29 @@
+/*
+ * usuario/interactivo.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que imita a un proceso interactivo: duerme,
+ * escribe algo y vuelve a dormir. Lo usa prueba_mlfq.
+ */
+
+#include "servicios.h"
+
+#define NUM_RONDAS 5	/* ponga las que considere oportuno */
+
+int main(){
+	int i, id;
+
+	id=obtener_id_pr();
+	for (i=0; i<NUM_RONDAS; i++){
+		dormir(1);
+		printf("interactivo (%d): ronda %d\n", id, i);
+	}
+	printf("interactivo (%d): termina\n", id);
+	return 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * usuario/lector_rw.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que lee ITERACIONES veces un estado compartido
+ * protegido por "lect": con rdlock si es un rwlock o con lock si es un
+ * mutex (prueba_rwlock crea uno u otro). Cada lectura hace un trabajo
+ * largo con el cerrojo cogido. Termina con los ticks que ha esperado
+ * para cogerlo, que recoge prueba_rwlock.
+ */
+
+#include "servicios.h"
+
+#define ITERACIONES 50
+#define TRABAJO_DENTRO 4000000
+#define TRABAJO_FUERA 1000
+
+static volatile int basura;
+
+static void trabajar(int n){
+	int i;
+
+	for (i=0; i<n; i++)
+		basura+=i;
+}
+
+int main(){
+	const volatile struct datos_nucleo *datos=pagina_datos();
+	int desc, es_rw, i;
+	unsigned long ini, espera=0;
+
+	if ((desc=abrir_rwlock("lect"))>=0)
+		es_rw=1;
+	else if ((desc=abrir_mutex("lect"))>=0)
+		es_rw=0;
+	else {
+		printf("lector_rw: error abriendo lect\n");
+		return 1;
+	}
+	for (i=0; i<ITERACIONES; i++){
+		ini=datos->ticks;
+		if ((es_rw ? rdlock(desc) : lock(desc))<0)
+			printf("lector_rw: error cogiendo lect\n");
+		espera+=datos->ticks-ini;
+		trabajar(TRABAJO_DENTRO);
+		if ((es_rw ? rwunlock(desc) : unlock(desc))<0)
+			printf("lector_rw: error soltando lect\n");
+		trabajar(TRABAJO_FUERA);
+	}
+	if (es_rw)
+		cerrar_rwlock(desc);
+	else
+		cerrar_mutex(desc);
+	terminar_proceso_estado((int)espera);
+	return 0;
+}
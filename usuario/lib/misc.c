@@ -0,0 +1,85 @@
+/*
+ *  usuario/lib/misc.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ */
+
+/*
+ *
+ * Fichero que contiene una implementacin en fuente del mdulo "misc"
+ * de la biblioteca de usuario, equivalente al proporcionado como objeto
+ * binario (misc.o_32 y misc.o_64). Se usa en lugar de ste compilando
+ * con "make MISC=fuente".
+ *
+ * A diferencia del binario, la llamada al sistema se hace con una seal
+ * dirigida al hilo que la invoca (pthread_sigqueue) que lleva la
+ * direccin de los registros, que estn en la pila del proceso. As
+ * funciona con el ncleo multiprocesador (-DSMP), donde cada procesador
+ * es un hilo y varios procesos pueden hacer llamadas a la vez. Requiere
+ * el HAL de fuente (make HAL=fuente en minikernel).
+ *
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include "servicios.h"
+
+/* Registros generales del procesador (como en minikernel/include/HAL.h) */
+#define NREGS 6
+
+#define TAM_BUF_ESCRIBIRF 1024
+
+/* Registros del HAL binario; el HAL la fija al cargar el programa */
+long *reglib;
+
+/* Versin de printf que usa la llamada escribir */
+int escribirf(const char *formato, ...){
+	char buf[TAM_BUF_ESCRIBIRF];
+	va_list args;
+	int n;
+
+	va_start(args, formato);
+	n=vsnprintf(buf, sizeof(buf), formato, args);
+	va_end(args);
+	if (n > 0)
+		escribir(buf, strlen(buf));
+	return n;
+}
+
+/* Instruccin de llamada al sistema */
+static void trap(long *regs){
+	union sigval valor;
+
+	valor.sival_ptr=regs;
+	pthread_sigqueue(pthread_self(), SIGUSR1, valor);
+}
+
+/*
+ * Prepara el cdigo de la llamada (en el registro 0) y los parmetros
+ * (en los registros 1, 2, ...), realiza la llamada y devuelve el
+ * resultado, que el ncleo deja en el registro 0
+ */
+int llamsis(int llamada, int nargs, ... /* args */){
+	long regs[NREGS];
+	va_list args;
+	int i;
+
+	regs[0]=llamada;
+	va_start(args, nargs);
+	for (i=1; i<=nargs && i<NREGS; i++)
+		regs[i]=va_arg(args, long);
+	va_end(args);
+	trap(regs);
+	return regs[0];
+}
+
+/* Punto de arranque del proceso: invoca a "main" y termina */
+void start(int (*principal)()){
+	principal();
+	terminar_proceso();
+}
@@ -43,7 +43,13 @@ int terminar_proceso(){
 int escribir(char *texto, unsigned int longi){
 	return llamsis(ESCRIBIR, 2, (long)texto, (long)longi);
 }
+/* Con un procesador, el proceso en ejecucion es el que pregunta y no
+   hace falta llamar al sistema */
 int obtener_id_pr(){
+	const volatile struct datos_nucleo *datos=pagina_datos();
+
+	if (datos!=0 && datos->num_ucps==1)
+		return datos->id_actual;
 	return llamsis(OBTENERID, 3);
 }
 // Creado por nosotros
@@ -56,13 +62,159 @@ int crear_mutex(char* nombre, int tipo){
 int abrir_mutex(char* nombre){
 	return llamsis(ABRIR_MUTEX, 1, nombre);
 }
+/* Entrada compartida del mutex si el proceso lo tiene abierto, o 0. En
+   propietario deja lo que pone el hilo en su palabra, que lee de la
+   cabecera de su pila */
+static volatile struct cerrojo_mutex *cerrojo_abierto(unsigned int mutex_id,
+		unsigned int *propietario){
+	const volatile struct datos_nucleo *datos=pagina_datos();
+	volatile struct cerrojo_mutex *cerrojos;
+	const struct cabecera_pila *cab;
+	unsigned int e;
+
+	if (datos==0)
+		return 0;
+	/* las entradas estan justo detras de la pagina de datos */
+	cerrojos=(volatile struct cerrojo_mutex *)(datos+1);
+	e=mutex_id%datos->num_mut;
+	if (cerrojos[e].id!=(int)mutex_id)
+		return 0;
+	cab=(const struct cabecera_pila *)((unsigned long)__builtin_frame_address(0)
+		& ~(unsigned long)(datos->tam_pila-1));
+	if (!(cab->mutex_abiertos[e/32] & (1U<<(e%32))))
+		return 0;
+	*propietario=cab->propietario;
+	return &cerrojos[e];
+}
+/* Si el mutex esta libre lo coge cambiando su palabra, y si ya es suyo
+   cuenta el bloqueo, sin llamar al sistema. Devuelve lo mismo que lock
+   o 1 si lo tiene otro. */
+static int coger_cerrojo(volatile struct cerrojo_mutex *c, unsigned int yo){
+	if (__sync_bool_compare_and_swap(&c->palabra, 0, yo)){
+		c->veces=1;
+		return 0;
+	}
+	if ((c->palabra & ~CERROJO_ESPERAN)==yo){
+		if (c->tipo==NO_RECURSIVO)
+			return -5;
+		c->veces++;
+		return 0;
+	}
+	return 1;
+}
+/* Si lo tiene otro, llama a lock para esperarlo */
 int lock(unsigned int mutex_id){
+	volatile struct cerrojo_mutex *c;
+	unsigned int yo;
+	int res;
+
+	if ((c=cerrojo_abierto(mutex_id, &yo))!=0 && (res=coger_cerrojo(c, yo))<=0)
+		return res;
 	return llamsis(LOCK, 1, mutex_id);
 }
+/* Si lo tiene otro devuelve -8 sin llamar al sistema */
+int trylock(unsigned int mutex_id){
+	volatile struct cerrojo_mutex *c;
+	unsigned int yo;
+	int res;
+
+	if ((c=cerrojo_abierto(mutex_id, &yo))!=0)
+		return (res=coger_cerrojo(c, yo))<=0 ? res : -8;
+	return llamsis(TRYLOCK, 1, mutex_id);
+}
+/* Si lo tiene otro, llama a lock_timeout para esperarlo esos ticks */
+int lock_timeout(unsigned int mutex_id, unsigned int ticks){
+	volatile struct cerrojo_mutex *c;
+	unsigned int yo;
+	int res;
+
+	if ((c=cerrojo_abierto(mutex_id, &yo))!=0 && (res=coger_cerrojo(c, yo))<=0)
+		return res;
+	return llamsis(LOCK_TIMEOUT, 2, mutex_id, ticks);
+}
+/* Si es suyo y nadie lo espera, lo suelta cambiando su palabra. Si hay
+   procesos esperando, llama a unlock para que se lo ceda al primero. */
 int unlock(unsigned int mutex_id){
+	volatile struct cerrojo_mutex *c;
+	unsigned int yo;
+
+	if ((c=cerrojo_abierto(mutex_id, &yo))!=0 &&
+			(c->palabra & ~CERROJO_ESPERAN)==yo){
+		if (c->veces>1){
+			c->veces--;
+			return 0;
+		}
+		c->veces=0;
+		if (__sync_bool_compare_and_swap(&c->palabra, yo, 0))
+			return 0;
+		c->veces=1;
+	}
 	return llamsis(UNLOCK, 1, mutex_id);
 }
 int cerrar_mutex(unsigned int mutex_id){
 	return llamsis(CERRAR_MUTEX, 1, mutex_id);
 }
+int crear_rwlock(char *nombre, int preferencia){
+	return llamsis(CREAR_RWLOCK, 2, (long)nombre, (long)preferencia);
+}
+int abrir_rwlock(char *nombre){
+	return llamsis(ABRIR_RWLOCK, 1, (long)nombre);
+}
+int rdlock(unsigned int rw_id){
+	return llamsis(RDLOCK, 1, rw_id);
+}
+int wrlock(unsigned int rw_id){
+	return llamsis(WRLOCK, 1, rw_id);
+}
+int rwunlock(unsigned int rw_id){
+	return llamsis(RWUNLOCK, 1, rw_id);
+}
+int cerrar_rwlock(unsigned int rw_id){
+	return llamsis(CERRAR_RWLOCK, 1, rw_id);
+}
+int fijar_prioridad(unsigned int prioridad){
+	return llamsis(FIJAR_PRIORIDAD, 1, prioridad);
+}
+int fijar_afinidad(unsigned int afinidad){
+	return llamsis(FIJAR_AFINIDAD, 1, afinidad);
+}
+int crear_procesos(char *prog, int n, int *ids){
+	return llamsis(CREAR_PROCESOS, 3, (long)prog, (long)n, (long)ids);
+}
+/* Punto de arranque de los hilos: pide al ncleo su funcin y su
+   argumento, la invoca y termina el hilo */
+static int arranque_hilo(){
+	void (*funcion)(void *);
+	void *arg;
+
+	if (llamsis(DATOS_HILO, 2, (long)&funcion, (long)&arg)==0)
+		funcion(arg);
+	return terminar_hilo();
+}
+int crear_hilo(void (*funcion)(void *), void *arg){
+	return llamsis(CREAR_HILO, 3, (long)arranque_hilo, (long)funcion, (long)arg);
+}
+int terminar_hilo(){
+	return llamsis(TERMINAR_HILO, 0);
+}
+int terminar_proceso_estado(int estado){
+	return llamsis(TERMINAR_PROCESO_ESTADO, 1, (long)estado);
+}
+int esperar_proceso(int id, int *estado){
+	return llamsis(ESPERAR_PROCESO, 2, (long)id, (long)estado);
+}
+int tiempos_proceso(struct tiempos_ejec *t_ejec){
+	return llamsis(TIEMPOS_PROCESO, 1, (long)t_ejec);
+}
+/* La direccion de la pagina es la misma para todos los procesos, asi
+   que da igual que compartan esta variable (los de un mismo programa) */
+static const volatile struct datos_nucleo *pagina;
+
+const volatile struct datos_nucleo *pagina_datos(){
+	struct datos_nucleo *dir;
+
+	if (pagina==0 && llamsis(PAGINA_DATOS, 1, (long)&dir)==0)
+		pagina=dir;
+	return pagina;
+}
 //
@@ -0,0 +1,40 @@
+/*
+ * usuario/llenador.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que usa prueba_hueco_mutex para llenar la tabla de
+ * mutex: crea NUM_LLENADOS mutex con nombres que incluyen su
+ * identificador, duerme DURACION segundos y termina, cerrndolos.
+ */
+
+#include "servicios.h"
+
+#define NUM_LLENADOS 4
+#define DURACION 2
+
+int main(){
+	char nombre[8];
+	int id=obtener_id_pr(), i, n, d;
+
+	/* "l", la letra del mutex y el identificador (hasta 5 cifras) */
+	nombre[0]='l';
+	n=2;
+	for (d=10000; d>1; d/=10)
+		if (id>=d)
+			nombre[n++]='0'+(id/d)%10;
+	nombre[n++]='0'+id%10;
+	nombre[n]='\0';
+	for (i=0; i<NUM_LLENADOS; i++){
+		nombre[1]='a'+i;
+		if (crear_mutex(nombre, NO_RECURSIVO)<0)
+			printf("llenador: error creando %s\n", nombre);
+	}
+	dormir(DURACION);
+	return 0;
+}
@@ -0,0 +1,34 @@
+/*
+ * usuario/pingpong.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que cede el procesador repetidamente. Fijar la
+ * prioridad que ya tiene lo pone detrs de los dems procesos de su
+ * nivel, por lo que con dos pingpong cada llamada es un cambio de
+ * contexto. Lo usan prueba_cambios y prueba_hilos, que compara los
+ * ciclos por cambio que muestra con los de dos hilos.
+ */
+
+#include "servicios.h"
+
+#define TOT_CESIONES 20000	/* ponga las que considere oportuno */
+
+int main(){
+	unsigned long ini;
+	int i;
+
+	ini=__builtin_ia32_rdtsc();
+	for (i=0; i<TOT_CESIONES; i++)
+		fijar_prioridad(PRIORIDAD_DEFECTO);
+
+	/* entre dos cesiones propias hay dos cambios de contexto */
+	printf("pingpong (%d): termina, %lu ciclos/cambio\n", obtener_id_pr(),
+		(__builtin_ia32_rdtsc()-ini)/(2*TOT_CESIONES));
+	return 0;
+}
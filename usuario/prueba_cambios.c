@@ -0,0 +1,31 @@
+/*
+ * usuario/prueba_cambios.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que mide el coste del cambio de contexto. Crea
+ * dos procesos "pingpong" de la misma prioridad que se ceden el
+ * procesador el uno al otro. Al terminar el ltimo, el ncleo muestra
+ * los cambios de contexto por segundo y los ciclos por cambio si se ha
+ * compilado con OPCIONES=-DESTADISTICAS. Compare el resultado con el
+ * HAL binario y con "make HAL=fuente" en minikernel.
+ */
+
+#include "servicios.h"
+
+int main(){
+	printf("prueba_cambios: comienza\n");
+
+	if (crear_proceso("pingpong")<0)
+		printf("Error creando pingpong\n");
+	if (crear_proceso("pingpong")<0)
+		printf("Error creando pingpong\n");
+
+	printf("prueba_cambios: termina\n");
+	return 0;
+}
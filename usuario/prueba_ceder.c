@@ -0,0 +1,37 @@
+/*
+ * usuario/prueba_ceder.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que comprueba cundo cede el procesador
+ * fijar_prioridad. Crea dos procesos "alternador", de su misma
+ * prioridad, que se lo ceden el uno al otro en cada vuelta, por lo que
+ * sus mensajes deben salir alternados. Antes de que ejecuten sube su
+ * prioridad, lo que no debe cedrselo, y despus la baja por debajo de
+ * la suya, lo que debe dejarles terminar antes de que l siga.
+ */
+
+#include "servicios.h"
+
+int main(){
+	printf("prueba_ceder: comienza\n");
+
+	if (crear_proceso("alternador")<0)
+		printf("Error creando alternador\n");
+	if (crear_proceso("alternador")<0)
+		printf("Error creando alternador\n");
+
+	fijar_prioridad(PRIORIDAD_DEFECTO+1);
+	printf("prueba_ceder: sube la prioridad (antes que los alternador)\n");
+
+	fijar_prioridad(PRIORIDAD_DEFECTO-1);
+	printf("prueba_ceder: baja la prioridad (despues que los alternador)\n");
+
+	printf("prueba_ceder: termina\n");
+	return 0;
+}
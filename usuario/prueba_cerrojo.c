@@ -0,0 +1,113 @@
+/*
+ * usuario/prueba_cerrojo.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que prueba lock y unlock sin nadie ms usando el
+ * mutex, que la biblioteca resuelve sin llamar al sistema. Comprueba
+ * primero los errores y los bloqueos de un mutex recursivo, luego mide
+ * los pares lock/unlock por segundo (los ciclos de un segundo los mide
+ * durmiendo) y por ltimo varios hilos suman en una variable cediendo
+ * el procesador con el mutex cogido, para que los dems lo esperen.
+ */
+
+#include "servicios.h"
+
+#define PARES 200000
+#define NUM_SUMADORES 4
+#define VUELTAS 1000
+#define CADA 50		/* vueltas entre cesiones con el mutex cogido */
+
+static int mutex_id;
+static volatile int contador=0;
+static volatile int terminados=0;
+
+static unsigned long leer_ciclos(){
+	return __builtin_ia32_rdtsc();
+}
+
+static void sumador(void *arg){
+	int i;
+
+	for (i=0; i<VUELTAS; i++){
+		lock(mutex_id);
+		contador++;
+		if (i%CADA==0)
+			fijar_prioridad(PRIORIDAD_DEFECTO);
+		unlock(mutex_id);
+	}
+	lock(mutex_id);
+	terminados++;
+	unlock(mutex_id);
+}
+
+/* mide lo que cuesta cada par en ciclos y cuantos caben en un segundo */
+static void medir(char *que, int id, int anidados, unsigned long ciclos_seg){
+	unsigned long ini, ciclos;
+	int i, j;
+
+	ini=leer_ciclos();
+	for (i=0; i<PARES/anidados; i++){
+		for (j=0; j<anidados; j++)
+			lock(id);
+		for (j=0; j<anidados; j++)
+			unlock(id);
+	}
+	ciclos=(leer_ciclos()-ini)/PARES;
+	printf("prueba_cerrojo: %s: %lu ciclos/par, %lu pares/s\n",
+		que, ciclos, ciclos_seg/(ciclos?ciclos:1));
+}
+
+int main(){
+	unsigned long ini, ciclos_seg;
+	int rec, i, r[4];
+
+	printf("prueba_cerrojo: comienza\n");
+	fijar_afinidad(1);
+	mutex_id=crear_mutex("cerr", NO_RECURSIVO);
+	rec=crear_mutex("cerr_r", RECURSIVO);
+	if (mutex_id<0 || rec<0){
+		printf("prueba_cerrojo: error creando los mutex\n");
+		return 1;
+	}
+
+	r[0]=lock(mutex_id);
+	r[1]=lock(mutex_id);
+	r[2]=unlock(mutex_id);
+	r[3]=unlock(mutex_id);
+	printf("prueba_cerrojo: no recursivo: %d %d %d %d (esperado 0 -5 0 -6)\n",
+		r[0], r[1], r[2], r[3]);
+	i=crear_mutex("cerr_x", NO_RECURSIVO);
+	cerrar_mutex(i);
+	printf("prueba_cerrojo: cerrado: %d (esperado -3)\n", lock(i));
+	for (i=0; i<3; i++)
+		lock(rec);
+	for (i=0; i<3; i++)
+		r[i]=unlock(rec);
+	r[3]=lock(mutex_id);
+	unlock(mutex_id);
+	printf("prueba_cerrojo: recursivo: %d %d %d, despues %d (esperado 0 0 0 0)\n",
+		r[0], r[1], r[2], r[3]);
+
+	ini=leer_ciclos();
+	dormir(1);
+	ciclos_seg=leer_ciclos()-ini;
+	medir("no recursivo", mutex_id, 1, ciclos_seg);
+	medir("recursivo, 2 anidados", rec, 2, ciclos_seg);
+
+	for (i=0; i<NUM_SUMADORES; i++)
+		if (crear_hilo(sumador, 0)<0)
+			printf("Error creando hilo sumador\n");
+	while (terminados<NUM_SUMADORES)
+		dormir(1);
+	printf("prueba_cerrojo: contador %d (esperado %d)\n",
+		contador, NUM_SUMADORES*VUELTAS);
+
+	printf("prueba_cerrojo: termina\n");
+	return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ * usuario/prueba_contencion.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que mide el coste de un mutex muy disputado:
+ * crea el mutex "cont" y, para distinto nmero de procesos
+ * "contendiente", cuenta los cambios de contexto que hay por cada vez
+ * que uno de ellos consigue el mutex (con la pgina de datos del
+ * ncleo) y los ticks que tardan en terminar todos.
+ */
+
+#include "servicios.h"
+
+#define MAX_CONTENDIENTES 16
+#define ITERACIONES 20		/* las de contendiente */
+
+int main(){
+	const volatile struct datos_nucleo *datos=pagina_datos();
+	int grupos[]={2, 4, 8, MAX_CONTENDIENTES};
+	int ids[MAX_CONTENDIENTES];
+	int g, i, n, desc;
+	unsigned long cambios, ticks;
+
+	printf("prueba_contencion: comienza\n");
+	if ((desc=crear_mutex("cont", NO_RECURSIVO))<0){
+		printf("prueba_contencion: error creando cont\n");
+		return 1;
+	}
+
+	for (g=0; g<sizeof(grupos)/sizeof(grupos[0]); g++){
+		n=grupos[g];
+		cambios=datos->cambios_contexto;
+		ticks=datos->ticks;
+		for (i=0; i<n; i++)
+			if ((ids[i]=crear_proceso("contendiente"))<0)
+				printf("Error creando contendiente\n");
+		for (i=0; i<n; i++)
+			esperar_proceso(ids[i], 0);
+		cambios=datos->cambios_contexto-cambios;
+		ticks=datos->ticks-ticks;
+		printf("prueba_contencion: %d procesos: %lu cambios de contexto, %lu.%02lu por adquisicion, %lu ticks\n",
+			n, cambios, cambios/(n*ITERACIONES),
+			cambios*100/(n*ITERACIONES)%100, ticks);
+	}
+
+	cerrar_mutex(desc);
+	printf("prueba_contencion: termina\n");
+	return 0;
+}
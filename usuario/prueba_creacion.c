@@ -0,0 +1,47 @@
+/*
+ * usuario/prueba_creacion.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que mide el coste de crear y terminar procesos.
+ * Crea NUM_TANDAS tandas de procesos "efimero", que terminan nada ms
+ * empezar, y espera a que terminen tras cada una, de modo que desde
+ * la segunda tanda los procesos nuevos pueden usar las pilas de los que
+ * han terminado. Al terminar el ltimo, el ncleo (compilado con
+ * OPCIONES=-DESTADISTICAS) muestra las creaciones y terminaciones por
+ * segundo y cuntas pilas e imgenes de programas han salido de las
+ * caches (se puede comparar con un ncleo compilado adems con
+ * -DMAX_PILAS_LIBRES=0 -DMAX_IMAGENES_LIBRES=0, en el que no se guardan
+ * para reutilizarlas).
+ */
+
+#include "servicios.h"
+
+#define NUM_TANDAS 10
+#define NUM_HIJOS 100	/* ponga los que considere oportuno */
+
+int main(){
+	int ids[NUM_HIJOS];
+	int i, tanda;
+
+	printf("prueba_creacion: comienza\n");
+
+	/* mxima prioridad para crear cada tanda antes de que ejecute */
+	fijar_prioridad(NUM_PRIORIDADES-1);
+
+	for (tanda=0; tanda<NUM_TANDAS; tanda++){
+		for (i=0; i<NUM_HIJOS; i++)
+			if ((ids[i]=crear_proceso("efimero"))<0)
+				printf("Error creando efimero\n");
+		for (i=0; i<NUM_HIJOS; i++)
+			esperar_proceso(ids[i], 0);
+	}
+
+	printf("prueba_creacion: termina\n");
+	return 0;
+}
@@ -0,0 +1,41 @@
+/*
+ * usuario/prueba_equilibrado.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que prueba el reparto de carga entre procesadores.
+ * Crea varios procesos "mudo", que empiezan todos en el procesador de
+ * este, y dos "anclado", que se restringen al ltimo procesador. Al
+ * terminar el ltimo, el ncleo muestra el tiempo total y, por cada
+ * procesador, los ticks que ha estado ocupado, los robos y las
+ * migraciones. Requiere un ncleo compilado con
+ * OPCIONES="-DSMP ... -DESTADISTICAS" y
+ * los programas con "make MISC=fuente" (el guion prueba_equilibrado.sh
+ * lo compara con y sin reparto peridico).
+ */
+
+#include "servicios.h"
+
+#define NUM_MUDOS 8
+#define NUM_ANCLADOS 2
+
+int main(){
+	int i;
+
+	printf("prueba_equilibrado: comienza\n");
+
+	for (i=0; i<NUM_MUDOS; i++)
+		if (crear_proceso("mudo")<0)
+			printf("Error creando mudo\n");
+	for (i=0; i<NUM_ANCLADOS; i++)
+		if (crear_proceso("anclado")<0)
+			printf("Error creando anclado\n");
+
+	printf("prueba_equilibrado: termina\n");
+	return 0;
+}
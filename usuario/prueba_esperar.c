@@ -0,0 +1,65 @@
+/*
+ * usuario/prueba_esperar.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que prueba la llamada esperar_proceso. Espera a
+ * un hijo que ya ha terminado, a dos que an no lo han hecho (en orden
+ * inverso al de creacin), a uno que termina por una excepcin y a uno
+ * que vuelve de main, comprobando sus cdigos de terminacin. Esperar a
+ * un proceso ya recogido o que no es hijo debe fallar.
+ */
+
+#include "servicios.h"
+
+static void comprobar(int id, int esperado){
+	int estado;
+
+	if (esperar_proceso(id, &estado)<0)
+		printf("prueba_esperar: error esperando a %d. NO DEBE APARECER\n", id);
+	else if (estado!=esperado)
+		printf("prueba_esperar: %d termina con %d en vez de %d. NO DEBE APARECER\n",
+			id, estado, esperado);
+	else
+		printf("prueba_esperar: %d termina con %d\n", id, estado);
+}
+
+int main(){
+	int id1, id2, id3;
+
+	printf("prueba_esperar: comienza\n");
+
+	if ((id1=crear_proceso("terminador"))<0)
+		printf("Error creando terminador\n");
+	printf("prueba_esperar: duerme 1 segundo para que termine %d\n", id1);
+	dormir(1);
+	comprobar(id1, id1);
+
+	if ((id1=crear_proceso("terminador"))<0)
+		printf("Error creando terminador\n");
+	if ((id2=crear_proceso("terminador"))<0)
+		printf("Error creando terminador\n");
+	comprobar(id2, id2);
+	comprobar(id1, id1);
+
+	if ((id3=crear_proceso("excep_arit"))<0)
+		printf("Error creando excep_arit\n");
+	comprobar(id3, ESTADO_EXCEPCION);
+
+	if ((id3=crear_proceso("efimero"))<0)
+		printf("Error creando efimero\n");
+	comprobar(id3, 0);
+
+	if (esperar_proceso(id3, 0)==0)
+		printf("prueba_esperar: %d ya recogido. NO DEBE APARECER\n", id3);
+	if (esperar_proceso(obtener_id_pr(), 0)==0)
+		printf("prueba_esperar: no es hijo. NO DEBE APARECER\n");
+
+	printf("prueba_esperar: termina\n");
+	return 0;
+}
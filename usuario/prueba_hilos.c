@@ -0,0 +1,115 @@
+/*
+ * usuario/prueba_hilos.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que prueba los hilos y los compara con los
+ * procesos. Primero varios hilos suman en una variable global usando un
+ * mutex que crea el hilo inicial, sin abrirlo ellos. Despus mide con el
+ * contador de ciclos del procesador lo que cuesta crear hilos y crear
+ * procesos "efimero". Por ltimo dos hilos se ceden el procesador el uno
+ * al otro, como hacen dos procesos "pingpong", que se crean a
+ * continuacin; cada uno muestra los ciclos por cambio de contexto.
+ * Todos ejecutan en el procesador 0 para que cada cesin sea un cambio.
+ */
+
+#include "servicios.h"
+
+#define NUM_SUMADORES 4
+#define VUELTAS 100
+#define NUM_CREADOS 100
+#define TOT_CESIONES 2000
+
+static int mutex_id;
+static volatile int contador=0;
+static volatile int terminados=0;
+
+static unsigned long leer_ciclos(){
+	return __builtin_ia32_rdtsc();
+}
+
+/* suma VUELTAS veces cediendo el procesador dentro de la seccin crtica */
+static void sumador(void *arg){
+	int i, valor;
+
+	for (i=0; i<VUELTAS; i++){
+		lock(mutex_id);
+		valor=contador;
+		fijar_prioridad(PRIORIDAD_DEFECTO);
+		contador=valor+1;
+		unlock(mutex_id);
+	}
+	lock(mutex_id);
+	terminados++;
+	unlock(mutex_id);
+}
+
+static void vacio(void *arg){
+}
+
+/* igual que "pingpong": cada cesin es un cambio de contexto */
+static void cedente(void *arg){
+	unsigned long ini;
+	int i;
+
+	ini=leer_ciclos();
+	for (i=0; i<TOT_CESIONES; i++)
+		fijar_prioridad(PRIORIDAD_DEFECTO);
+	printf("prueba_hilos: cedente: %lu ciclos/cambio\n",
+		(leer_ciclos()-ini)/(2*TOT_CESIONES));
+	lock(mutex_id);
+	terminados++;
+	unlock(mutex_id);
+}
+
+int main(){
+	unsigned long ini, ciclos_hilos, ciclos_procesos;
+	int i, prio;
+
+	printf("prueba_hilos: comienza\n");
+	fijar_afinidad(1);
+
+	mutex_id=crear_mutex("m_hilos", NO_RECURSIVO);
+	for (i=0; i<NUM_SUMADORES; i++)
+		if (crear_hilo(sumador, 0)<0)
+			printf("Error creando hilo sumador\n");
+	while (terminados<NUM_SUMADORES)
+		dormir(1);
+	printf("prueba_hilos: contador %d (esperado %d)\n",
+		contador, NUM_SUMADORES*VUELTAS);
+
+	/* mxima prioridad para crear todos antes de que ejecuten */
+	prio=fijar_prioridad(NUM_PRIORIDADES-1);
+	ini=leer_ciclos();
+	for (i=0; i<NUM_CREADOS; i++)
+		if (crear_hilo(vacio, 0)<0)
+			printf("Error creando hilo vacio\n");
+	ciclos_hilos=leer_ciclos()-ini;
+	ini=leer_ciclos();
+	for (i=0; i<NUM_CREADOS; i++)
+		if (crear_proceso("efimero")<0)
+			printf("Error creando efimero\n");
+	ciclos_procesos=leer_ciclos()-ini;
+	fijar_prioridad(prio);
+	dormir(1);
+	printf("prueba_hilos: creacin: %lu ciclos/hilo, %lu ciclos/proceso\n",
+		ciclos_hilos/NUM_CREADOS, ciclos_procesos/NUM_CREADOS);
+
+	terminados=0;
+	for (i=0; i<2; i++)
+		if (crear_hilo(cedente, 0)<0)
+			printf("Error creando hilo cedente\n");
+	while (terminados<2)
+		dormir(1);
+	for (i=0; i<2; i++)
+		if (crear_proceso("pingpong")<0)
+			printf("Error creando pingpong\n");
+
+	printf("prueba_hilos: termina\n");
+	return 0;
+}
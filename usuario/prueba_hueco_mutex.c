@@ -0,0 +1,70 @@
+/*
+ * usuario/prueba_hueco_mutex.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que mide lo que tarda crear_mutex en volver cuando
+ * la tabla de mutex est llena y se libera una entrada. Llena la tabla
+ * con procesos "llenador", que terminan al cabo de unos segundos
+ * cerrando sus mutex, y mientras tanto intenta crear otro. Un hilo
+ * espera al primer llenador y anota el tick en que termina; el retraso
+ * es lo que pasa desde ese tick hasta que crear_mutex vuelve (con la
+ * pgina de datos del ncleo). Los llenadores ocupan las NUM_MUT (16)
+ * entradas de la tabla por defecto.
+ */
+
+#include "servicios.h"
+
+#define VUELTAS 3
+#define NUM_LLENADORES 4	/* de 4 mutex cada uno */
+#define ESPERA_CREAR 50		/* ticks que pasan antes de crear el mutex */
+
+static volatile int primero;
+static volatile unsigned long fin_llenador;
+
+static void esperador(void *arg){
+	esperar_proceso(primero, 0);
+	fin_llenador=pagina_datos()->ticks;
+}
+
+int main(){
+	const volatile struct datos_nucleo *datos=pagina_datos();
+	unsigned long fin_crear, ini, retraso, maximo=0;
+	int ids[NUM_LLENADORES], v, i, desc;
+
+	printf("prueba_hueco_mutex: comienza\n");
+	for (v=0; v<VUELTAS; v++){
+		fin_llenador=0;
+		for (i=0; i<NUM_LLENADORES; i++)
+			if ((ids[i]=crear_proceso("llenador"))<0)
+				printf("Error creando llenador\n");
+		/* deja que llenen la tabla */
+		dormir(1);
+		primero=ids[0];
+		if (crear_hilo(esperador, 0)<0)
+			printf("Error creando hilo esperador\n");
+		ini=datos->ticks;
+		while (datos->ticks<ini+ESPERA_CREAR);
+		if ((desc=crear_mutex("nuevo", NO_RECURSIVO))<0)
+			printf("prueba_hueco_mutex: error creando nuevo\n");
+		fin_crear=datos->ticks;
+		while (fin_llenador==0)
+			dormir(1);
+		retraso=fin_crear>fin_llenador ? fin_crear-fin_llenador : 0;
+		printf("prueba_hueco_mutex: vuelta %d: crear_mutex vuelve %lu ticks despus\n",
+			v, retraso);
+		if (retraso>maximo)
+			maximo=retraso;
+		cerrar_mutex(desc);
+		for (i=0; i<NUM_LLENADORES; i++)
+			esperar_proceso(ids[i], 0);
+	}
+	printf("prueba_hueco_mutex: retraso mximo %lu ticks\n", maximo);
+	printf("prueba_hueco_mutex: termina\n");
+	return 0;
+}
@@ -0,0 +1,147 @@
+/*
+ * usuario/prueba_interbloqueo.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que prueba la deteccin de interbloqueos de los
+ * mutex. Primero mide los ciclos de cada lock que se bloquea, con dos
+ * hilos que se pasan un mutex cediendo el procesador mientras lo
+ * tienen (compilando el ncleo con DETECTAR_INTERBLOQUEOS a 0 y a 1 se
+ * ve lo que cuesta la comprobacin). Despus forma un ciclo de 2 y otro
+ * de 3 hilos, cada uno con un mutex y esperando el del siguiente: el
+ * ltimo en pedirlo debe recibir -7 en vez de bloquearse y, al soltar
+ * el suyo, los dems terminan. Sin deteccin se quedan bloqueados. Por
+ * ltimo repite el ciclo de 2 despus de que el mutex del primero haya
+ * cambiado de propietario sin llamar al sistema: el ncleo solo conoce
+ * al anterior, que sigue vivo, y debe encontrar al nuevo por su
+ * identificador.
+ */
+
+#include "servicios.h"
+
+#define MAX_CICLO 3
+#define PASES 2000
+
+struct eslabon {
+	int tiene, pide;	/* mutex que coge y el que pide despus */
+	int espera;		/* segundos entre ambos */
+	int resultado;		/* lo que devuelve el segundo lock */
+};
+
+static int mutex_ids[MAX_CICLO];
+static struct eslabon eslabones[MAX_CICLO];
+static volatile int terminados;
+static volatile int soltado, fin_antiguo, antiguo_terminado;
+
+static unsigned long leer_ciclos(){
+	return __builtin_ia32_rdtsc();
+}
+
+static void hilo_ciclo(void *arg){
+	struct eslabon *e=arg;
+
+	lock(e->tiene);
+	dormir(e->espera);
+	e->resultado=lock(e->pide);
+	if (e->resultado==0)
+		unlock(e->pide);
+	unlock(e->tiene);
+	terminados++;
+}
+
+/* n hilos en ciclo: el i tiene el mutex i y pide el i+1; el ltimo que
+   lo pide es el n-1 */
+static void ciclo(int n){
+	int i;
+
+	terminados=0;
+	for (i=0; i<n; i++){
+		eslabones[i].tiene=mutex_ids[i];
+		eslabones[i].pide=mutex_ids[(i+1)%n];
+		eslabones[i].espera=i+1;
+		eslabones[i].resultado=1;
+		if (crear_hilo(hilo_ciclo, &eslabones[i])<0)
+			printf("Error creando hilo\n");
+	}
+	while (terminados<n)
+		dormir(1);
+	printf("prueba_interbloqueo: ciclo de %d:", n);
+	for (i=0; i<n; i++)
+		printf(" %d", eslabones[i].resultado);
+	printf(" (esperado");
+	for (i=0; i<n-1; i++)
+		printf(" 0");
+	printf(" -7)\n");
+}
+
+/* recibe el mutex 0 del hilo inicial en unlock, por lo que el ncleo lo
+   anota como su propietario, y lo suelta sin llamar al sistema porque
+   nadie lo espera; sigue vivo hasta que termina el ciclo */
+static void antiguo(void *arg){
+	lock(mutex_ids[0]);
+	unlock(mutex_ids[0]);
+	soltado=1;
+	while (!fin_antiguo)
+		dormir(1);
+	antiguo_terminado=1;
+}
+
+static void pasador(void *arg){
+	int i;
+
+	for (i=0; i<PASES; i++){
+		lock(mutex_ids[0]);
+		fijar_prioridad(PRIORIDAD_DEFECTO);
+		unlock(mutex_ids[0]);
+	}
+	terminados++;
+}
+
+int main(){
+	unsigned long ini;
+	int i;
+	char nombre[]="ib0";
+
+	printf("prueba_interbloqueo: comienza\n");
+	fijar_afinidad(1);
+	for (i=0; i<MAX_CICLO; i++){
+		nombre[2]='0'+i;
+		if ((mutex_ids[i]=crear_mutex(nombre, NO_RECURSIVO))<0){
+			printf("prueba_interbloqueo: error creando %s\n", nombre);
+			return 1;
+		}
+	}
+
+	terminados=0;
+	ini=leer_ciclos();
+	for (i=0; i<2; i++)
+		if (crear_hilo(pasador, 0)<0)
+			printf("Error creando hilo pasador\n");
+	while (terminados<2)
+		fijar_prioridad(PRIORIDAD_DEFECTO);
+	printf("prueba_interbloqueo: %lu ciclos/pase del mutex\n",
+		(leer_ciclos()-ini)/(2*PASES));
+
+	ciclo(2);
+	ciclo(3);
+
+	lock(mutex_ids[0]);
+	if (crear_hilo(antiguo, 0)<0)
+		printf("Error creando hilo antiguo\n");
+	dormir(1);	/* para que espere el mutex */
+	unlock(mutex_ids[0]);
+	while (!soltado)
+		dormir(1);
+	printf("prueba_interbloqueo: ib0 soltado sin llamar al sistema\n");
+	ciclo(2);
+	fin_antiguo=1;
+	while (!antiguo_terminado)
+		dormir(1);
+	printf("prueba_interbloqueo: termina\n");
+	return 0;
+}
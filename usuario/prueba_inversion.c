@@ -0,0 +1,100 @@
+/*
+ * usuario/prueba_inversion.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que prueba la herencia de prioridad de los mutex
+ * con el caso clsico de inversin: un hilo de prioridad baja coge el
+ * mutex "inv" y, mientras lo tiene, uno de prioridad alta lo pide y dos
+ * de prioridad intermedia se ponen a calcular. Sin herencia los
+ * intermedios retrasan al de alta prioridad todo lo que calculan; con
+ * ella el de baja termina su seccin crtica antes que ellos. Muestra
+ * los ticks que espera el de alta prioridad en cada vuelta (con la
+ * pgina de datos del ncleo). Todos ejecutan en el procesador 0.
+ */
+
+#include "servicios.h"
+
+#define VUELTAS 3
+#define NUM_MEDIOS 2
+#define TICKS_BAJO 200		/* los que tiene el mutex el de baja (> 1 s) */
+#define TICKS_MEDIO 300		/* los que calcula cada intermedio */
+
+static int mutex_id;
+static volatile int terminados;
+static volatile unsigned long espera;
+
+/* calcula hasta que pasan esos ticks */
+static void calcular(unsigned long ticks){
+	const volatile struct datos_nucleo *datos=pagina_datos();
+	unsigned long fin=datos->ticks+ticks;
+
+	while (datos->ticks<fin);
+}
+
+static void bajo(void *arg){
+	fijar_prioridad(5);
+	lock(mutex_id);
+	calcular(TICKS_BAJO);
+	unlock(mutex_id);
+	terminados++;
+}
+
+static void alto(void *arg){
+	unsigned long ini;
+
+	fijar_prioridad(20);
+	ini=pagina_datos()->ticks;
+	lock(mutex_id);
+	espera=pagina_datos()->ticks-ini;
+	unlock(mutex_id);
+	terminados++;
+}
+
+static void medio(void *arg){
+	fijar_prioridad(10);
+	calcular(TICKS_MEDIO);
+	terminados++;
+}
+
+int main(){
+	unsigned long maxima=0;
+	int v, i;
+
+	printf("prueba_inversion: comienza\n");
+	fijar_afinidad(1);
+	fijar_prioridad(30);
+	if ((mutex_id=crear_mutex("inv", NO_RECURSIVO))<0){
+		printf("prueba_inversion: error creando inv\n");
+		return 1;
+	}
+
+	for (v=0; v<VUELTAS; v++){
+		terminados=0;
+		if (crear_hilo(bajo, 0)<0)
+			printf("Error creando hilo bajo\n");
+		/* deja que el de baja prioridad coja el mutex */
+		dormir(1);
+		if (crear_hilo(alto, 0)<0)
+			printf("Error creando hilo alto\n");
+		for (i=0; i<NUM_MEDIOS; i++)
+			if (crear_hilo(medio, 0)<0)
+				printf("Error creando hilo medio\n");
+		while (terminados<NUM_MEDIOS+2)
+			dormir(1);
+		printf("prueba_inversion: vuelta %d: el de prioridad alta espera %lu ticks\n",
+			v, espera);
+		if (espera>maxima)
+			maxima=espera;
+	}
+	printf("prueba_inversion: espera mxima %lu ticks (el de baja tiene el mutex %d)\n",
+		maxima, TICKS_BAJO);
+	cerrar_mutex(mutex_id);
+	printf("prueba_inversion: termina\n");
+	return 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * usuario/prueba_lotes.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que compara el coste de crear procesos uno a uno
+ * con crear_proceso y de una vez con crear_procesos. Para cada tamao
+ * de tanda crea los procesos "efimero" de las dos formas, midiendo los
+ * ciclos que tarda con el contador del procesador, y espera a que
+ * terminen antes de la siguiente.
+ */
+
+#include "servicios.h"
+
+#define MAX_TANDA 100
+
+static unsigned long leer_ciclos(){
+	return __builtin_ia32_rdtsc();
+}
+
+int main(){
+	int tandas[]={1, 10, MAX_TANDA};
+	int ids[MAX_TANDA];
+	int t, i, n, creados;
+	unsigned long ini, uno_a_uno, en_lote;
+
+	printf("prueba_lotes: comienza\n");
+
+	/* mxima prioridad para crear cada tanda antes de que ejecute */
+	fijar_prioridad(NUM_PRIORIDADES-1);
+
+	for (t=0; t<sizeof(tandas)/sizeof(tandas[0]); t++){
+		n=tandas[t];
+
+		ini=leer_ciclos();
+		for (i=0; i<n; i++)
+			if ((ids[i]=crear_proceso("efimero"))<0)
+				printf("Error creando efimero\n");
+		uno_a_uno=leer_ciclos()-ini;
+		for (i=0; i<n; i++)
+			esperar_proceso(ids[i], 0);
+
+		ini=leer_ciclos();
+		creados=crear_procesos("efimero", n, ids);
+		en_lote=leer_ciclos()-ini;
+		if (creados!=n)
+			printf("Error creando efimero: creados %d de %d\n", creados, n);
+		for (i=0; i<creados; i++)
+			esperar_proceso(ids[i], 0);
+
+		printf("prueba_lotes: %d procesos: %lu ciclos/proceso uno a uno, %lu en lote\n",
+			n, uno_a_uno/n, en_lote/n);
+	}
+
+	printf("prueba_lotes: termina\n");
+	return 0;
+}
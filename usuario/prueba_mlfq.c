@@ -0,0 +1,39 @@
+/*
+ * usuario/prueba_mlfq.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que mezcla procesos que "gastan CPU" con procesos
+ * interactivos que duermen a menudo. Ejecutndolo con y sin MLFQ
+ * (make OPCIONES="-DMLFQ -DESTADISTICAS" y OPCIONES=-DESTADISTICAS en
+ * minikernel) se comparan la espera media y
+ * mxima de los interactivos al despertar y los ticks totales que
+ * tarda todo el trabajo, que muestra el ncleo al terminar.
+ */
+
+#include "servicios.h"
+
+#define NUM_CALCULADORES 4	/* ponga los que considere oportuno */
+#define NUM_INTERACTIVOS 2	/* ponga los que considere oportuno */
+
+int main(){
+	int i;
+
+	printf("prueba_mlfq: comienza\n");
+
+	for (i=0; i<NUM_CALCULADORES; i++)
+		if (crear_proceso("calculador")<0)
+			printf("Error creando calculador\n");
+
+	for (i=0; i<NUM_INTERACTIVOS; i++)
+		if (crear_proceso("interactivo")<0)
+			printf("Error creando interactivo\n");
+
+	printf("prueba_mlfq: termina\n");
+	return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * usuario/prueba_pagina.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que prueba la pgina de datos del ncleo. Crea
+ * varios procesos "efimero", que escriben su identificador obtenido de
+ * la pgina, y compara lo que cuesta obtener_id_pr, que la lee, con lo
+ * que cuesta una llamada al sistema. Comprueba adems que los ticks y
+ * los tiempos de la pgina coinciden con los de tiempos_proceso.
+ */
+
+#include "servicios.h"
+
+#define HIJOS 3
+#define VECES_PAGINA 1000000
+#define VECES_LLAMADA 1000
+#define TICKS_ESPERA 10
+
+static unsigned long leer_ciclos(){
+	return __builtin_ia32_rdtsc();
+}
+
+int main(){
+	const volatile struct datos_nucleo *datos;
+	struct tiempos_ejec tiempos;
+	int ids[HIJOS];
+	int i, id, suma=0, ticks;
+	unsigned long ini, fin, ciclos_pagina, ciclos_llamada;
+
+	printf("prueba_pagina: comienza\n");
+	if ((datos=pagina_datos())==0){
+		printf("prueba_pagina: error obteniendo la pagina de datos\n");
+		return 1;
+	}
+	id=obtener_id_pr();
+	printf("prueba_pagina: id %d, %d procesadores, %d procesos vivos\n",
+		id, datos->num_ucps, datos->procesos_vivos);
+
+	/* cada hijo escribe el id que ve en la pgina */
+	for (i=0; i<HIJOS; i++){
+		ids[i]=crear_proceso("efimero");
+		printf("prueba_pagina: creado efimero %d\n", ids[i]);
+	}
+	for (i=0; i<HIJOS; i++)
+		esperar_proceso(ids[i], 0);
+	if (obtener_id_pr()!=id)
+		printf("prueba_pagina: ERROR: id %d tras ejecutar los hijos\n",
+			obtener_id_pr());
+
+	ini=leer_ciclos();
+	for (i=0; i<VECES_PAGINA; i++)
+		suma+=obtener_id_pr();
+	ciclos_pagina=(leer_ciclos()-ini)/VECES_PAGINA;
+	if (suma!=id*VECES_PAGINA)
+		printf("prueba_pagina: ERROR: id distinto durante el bucle\n");
+
+	ini=leer_ciclos();
+	for (i=0; i<VECES_LLAMADA; i++)
+		tiempos_proceso(0);
+	ciclos_llamada=(leer_ciclos()-ini)/VECES_LLAMADA;
+	printf("prueba_pagina: obtener_id_pr %lu ciclos/llamada, llamada al sistema %lu ciclos/llamada\n",
+		ciclos_pagina, ciclos_llamada);
+
+	/* espera activa leyendo los ticks de la pgina */
+	ini=datos->ticks;
+	while (datos->ticks<ini+TICKS_ESPERA)
+		;
+	fin=datos->ticks;
+	ticks=tiempos_proceso(&tiempos);
+	printf("prueba_pagina: ticks de la pagina %lu->%lu, de tiempos_proceso %d\n",
+		ini, fin, ticks);
+	/* con varios procesadores la pgina no sabe cul es el actual */
+	if (datos->num_ucps==1)
+		printf("prueba_pagina: tiempos de la pagina %d/%d, de tiempos_proceso %d/%d\n",
+			datos->tiempos_actual.usuario, datos->tiempos_actual.sistema,
+			tiempos.usuario, tiempos.sistema);
+	printf("prueba_pagina: %lu procesos creados, %lu cambios de contexto\n",
+		datos->procesos_creados, datos->cambios_contexto);
+
+	printf("prueba_pagina: termina\n");
+	return 0;
+}
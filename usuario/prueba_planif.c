@@ -0,0 +1,38 @@
+/*
+ * usuario/prueba_planif.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que mide el coste de elegir el siguiente proceso
+ * con muchos procesos listos repartidos entre los niveles de prioridad.
+ * Crea tantos procesos "girador" como admita la tabla de procesos (hasta
+ * NUM_HIJOS). Al terminar el ltimo, el ncleo muestra los ciclos por
+ * eleccin del planificador en funcin del nmero de procesos listos
+ * si se ha compilado con OPCIONES=-DESTADISTICAS.
+ */
+
+#include "servicios.h"
+
+#define NUM_HIJOS 1000	/* ponga los que considere oportuno */
+
+int main(){
+	int i;
+
+	printf("prueba_planif: comienza\n");
+
+	/* mxima prioridad para crear todos los hijos antes de que ejecuten */
+	fijar_prioridad(NUM_PRIORIDADES-1);
+
+	for (i=0; i<NUM_HIJOS; i++)
+		if (crear_proceso("girador")<0)
+			break;
+
+	printf("prueba_planif: creados %d procesos girador\n", i);
+	printf("prueba_planif: termina\n");
+	return 0;
+}
@@ -0,0 +1,152 @@
+/*
+ * usuario/prueba_plazo_mutex.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que prueba trylock y lock_timeout con carga: el
+ * hilo inicial tiene el mutex "pm" mientras CARGA hilos calculan sin
+ * parar. Un hilo lo pide con distintos plazos, con ms prioridad que la
+ * carga y con la misma, y muestra lo que devuelve lock_timeout y los
+ * ticks que pasan (con la pgina de datos del ncleo). Despus
+ * comprueba que lo consigue si se suelta antes del plazo, lo que cuesta
+ * un trylock de un mutex ocupado y que, tras vencer los plazos de varios
+ * que lo esperan, lo consigue el que lo espera sin plazo.
+ */
+
+#include "servicios.h"
+
+#define CARGA 4
+#define NUM_PLAZOS 4
+#define TRYLOCKS 1000
+
+static int mutex_id;
+static volatile int fin_carga=0;
+static volatile int terminados;
+static volatile int resultado;
+static volatile unsigned long transcurrido;
+
+struct espera {
+	int prioridad;
+	unsigned int plazo;	/* 0: lock sin plazo */
+};
+
+static unsigned long leer_ciclos(){
+	return __builtin_ia32_rdtsc();
+}
+
+/* los hilos heredan la prioridad del que los crea */
+static void carga(void *arg){
+	fijar_prioridad(PRIORIDAD_DEFECTO);
+	while (!fin_carga);
+}
+
+static void esperador(void *arg){
+	struct espera *e=arg;
+	unsigned long ini;
+	int r;
+
+	fijar_prioridad(e->prioridad);
+	ini=pagina_datos()->ticks;
+	r=e->plazo ? lock_timeout(mutex_id, e->plazo) : lock(mutex_id);
+	transcurrido=pagina_datos()->ticks-ini;
+	resultado=r;
+	if (r==0)
+		unlock(mutex_id);
+	terminados++;
+}
+
+static void probador_trylock(void *arg){
+	unsigned long ini;
+	int i, ocupados=0;
+
+	ini=leer_ciclos();
+	for (i=0; i<TRYLOCKS; i++)
+		if (trylock(mutex_id)==-8)
+			ocupados++;
+	printf("prueba_plazo_mutex: trylock ocupado: %d de %d devuelven -8, %lu ciclos/trylock\n",
+		ocupados, TRYLOCKS, (leer_ciclos()-ini)/TRYLOCKS);
+	terminados++;
+}
+
+/* lanza un hilo esperador y espera a que termine */
+static void esperar(struct espera *e){
+	terminados=0;
+	if (crear_hilo(esperador, e)<0)
+		printf("Error creando hilo esperador\n");
+	while (terminados<1)
+		dormir(1);
+}
+
+int main(){
+	unsigned int plazos[NUM_PLAZOS]={1, 5, 20, 50};
+	int prioridades[2]={PRIORIDAD_DEFECTO+5, PRIORIDAD_DEFECTO};
+	struct espera e, varios[4];
+	int i, p;
+
+	printf("prueba_plazo_mutex: comienza\n");
+	fijar_afinidad(1);
+	fijar_prioridad(PRIORIDAD_DEFECTO+10);
+	if ((mutex_id=crear_mutex("pm", NO_RECURSIVO))<0){
+		printf("prueba_plazo_mutex: error creando pm\n");
+		return 1;
+	}
+	lock(mutex_id);
+	for (i=0; i<CARGA; i++)
+		if (crear_hilo(carga, 0)<0)
+			printf("Error creando hilo de carga\n");
+
+	for (p=0; p<2; p++)
+		for (i=0; i<NUM_PLAZOS; i++){
+			e.prioridad=prioridades[p];
+			e.plazo=plazos[i];
+			esperar(&e);
+			printf("prueba_plazo_mutex: prioridad %d (carga %d), plazo %u: devuelve %d tras %lu ticks\n",
+				e.prioridad, PRIORIDAD_DEFECTO, e.plazo, resultado,
+				transcurrido);
+		}
+
+	/* lo suelta antes de que venza el plazo */
+	e.prioridad=PRIORIDAD_DEFECTO+5;
+	e.plazo=300;
+	terminados=0;
+	if (crear_hilo(esperador, &e)<0)
+		printf("Error creando hilo esperador\n");
+	dormir(1);
+	unlock(mutex_id);
+	while (terminados<1)
+		dormir(1);
+	printf("prueba_plazo_mutex: soltado antes del plazo 300: devuelve %d tras %lu ticks\n",
+		resultado, transcurrido);
+	lock(mutex_id);
+
+	terminados=0;
+	if (crear_hilo(probador_trylock, 0)<0)
+		printf("Error creando hilo probador\n");
+	while (terminados<1)
+		dormir(1);
+
+	/* tres con plazo y uno sin el: al soltarlo lo consigue el ultimo */
+	terminados=0;
+	for (i=0; i<4; i++){
+		varios[i].prioridad=PRIORIDAD_DEFECTO+5;
+		varios[i].plazo=(i<3) ? 10*(i+1) : 0;
+		if (crear_hilo(esperador, &varios[i])<0)
+			printf("Error creando hilo esperador\n");
+	}
+	while (terminados<3)
+		dormir(1);
+	unlock(mutex_id);
+	while (terminados<4)
+		dormir(1);
+	printf("prueba_plazo_mutex: tras vencer 3 plazos, el que espera sin plazo devuelve %d\n",
+		resultado);
+
+	fin_carga=1;
+	printf("prueba_plazo_mutex: termina\n");
+	return 0;
+}
@@ -0,0 +1,35 @@
+/*
+ * usuario/prueba_plazos.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que pone a dormir a la vez a muchos procesos
+ * con plazos distintos. Crea tantos procesos "durmiente" como admita
+ * la tabla de procesos (hasta NUM_DURMIENTES). Al terminar, el ncleo
+ * muestra lo que cuesta la gestin de plazos en cada interrupcin de
+ * reloj en funcin del nmero de procesos dormidos si se ha compilado
+ * con OPCIONES=-DESTADISTICAS.
+ */
+
+#include "servicios.h"
+
+#define NUM_DURMIENTES 500	/* ponga los que considere oportuno */
+
+int main(){
+	int i;
+
+	printf("prueba_plazos: comienza\n");
+
+	for (i=0; i<NUM_DURMIENTES; i++)
+		if (crear_proceso("durmiente")<0)
+			break;
+
+	printf("prueba_plazos: creados %d procesos durmiente\n", i);
+	printf("prueba_plazos: termina\n");
+	return 0;
+}
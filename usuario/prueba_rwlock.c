@@ -0,0 +1,155 @@
+/*
+ * usuario/prueba_rwlock.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que prueba los rwlocks. Primero comprueba los
+ * errores y el orden en que lo consiguen un escritor y un lector que
+ * llegan mientras otro hilo lee, con cada preferencia. Despus mide
+ * cuntas lecturas por segundo hacen juntos distintos nmeros de
+ * procesos "lector_rw" si "lect" es un mutex y si es un rwlock, y lo que
+ * espera de media cada lectura para coger el cerrojo. Con un procesador
+ * (o con un anfitrin de un solo ncleo) las lecturas por segundo no
+ * pueden mejorar, pero con el rwlock los lectores no se esperan entre
+ * s; para ver cmo escala, compilar el ncleo con
+ * OPCIONES="-DSMP -DNUM_UCPS=4" y los programas con "make MISC=fuente".
+ */
+
+#include "servicios.h"
+
+#define MAX_LECTORES 4
+#define ITERACIONES 50		/* las de lector_rw */
+#define TICKS_POR_SEG 100	/* TICK del ncleo */
+
+static int rw_id;
+static volatile char orden[3];
+static volatile int num_orden;
+static volatile int terminados;
+
+static void escritor(void *arg){
+	if (wrlock(rw_id)==0){
+		orden[num_orden++]='E';
+		rwunlock(rw_id);
+	}
+	terminados++;
+}
+
+static void lector(void *arg){
+	if (rdlock(rw_id)==0){
+		orden[num_orden++]='L';
+		rwunlock(rw_id);
+	}
+	terminados++;
+}
+
+/*
+ * Mientras el hilo inicial lee, llegan un escritor y luego un lector:
+ * con preferencia de escritores el lector espera detrs del escritor
+ */
+static void probar_preferencia(int preferencia, const char *nombre,
+		const char *esperado){
+	if ((rw_id=crear_rwlock("pref", preferencia))<0){
+		printf("prueba_rwlock: error creando pref\n");
+		return;
+	}
+	num_orden=0;
+	terminados=0;
+	rdlock(rw_id);
+	if (crear_hilo(escritor, 0)<0 || crear_hilo(lector, 0)<0)
+		printf("Error creando hilo\n");
+	dormir(1);
+	rwunlock(rw_id);
+	while (terminados<2)
+		dormir(1);
+	orden[num_orden]='\0';
+	printf("prueba_rwlock: preferencia de %s: orden %s (esperado %s)\n",
+		nombre, (char *)orden, esperado);
+	cerrar_rwlock(rw_id);
+}
+
+/*
+ * Lanza n lectores sobre "lect" y devuelve los ticks que tardan y, en
+ * espera, la suma de los que han esperado para cogerlo
+ */
+static unsigned long medir(int n, unsigned long *espera){
+	const volatile struct datos_nucleo *datos=pagina_datos();
+	int ids[MAX_LECTORES];
+	unsigned long ticks=datos->ticks;
+	int i, estado;
+
+	for (i=0; i<n; i++)
+		if ((ids[i]=crear_proceso("lector_rw"))<0)
+			printf("Error creando lector_rw\n");
+	*espera=0;
+	for (i=0; i<n; i++)
+		if (esperar_proceso(ids[i], &estado)>=0 && estado>0)
+			*espera+=estado;
+	return datos->ticks-ticks;
+}
+
+int main(){
+	int grupos[]={1, 2, MAX_LECTORES};
+	int g, n, desc, es_rw, r1, r2, r3;
+	unsigned long ticks, espera;
+
+	printf("prueba_rwlock: comienza\n");
+
+	if ((desc=crear_rwlock("errs", PREFERENCIA_ESCRITORES))<0){
+		printf("prueba_rwlock: error creando errs\n");
+		return 1;
+	}
+	printf("prueba_rwlock: preferencia no valida: %d (esperado -4)\n",
+		crear_rwlock("otro", 7));
+	printf("prueba_rwlock: nombre repetido: %d (esperado -2)\n",
+		crear_rwlock("errs", PREFERENCIA_LECTORES));
+	printf("prueba_rwlock: rwunlock sin tenerlo: %d (esperado -6)\n",
+		rwunlock(desc));
+	r1=rdlock(desc);
+	r2=rdlock(desc);
+	printf("prueba_rwlock: rdlock dos veces: %d %d (esperado 0 -5)\n",
+		r1, r2);
+	printf("prueba_rwlock: wrlock leyendo: %d (esperado -5)\n",
+		wrlock(desc));
+	r1=rwunlock(desc);
+	r2=wrlock(desc);
+	r3=rwunlock(desc);
+	printf("prueba_rwlock: rwunlock, wrlock y rwunlock: %d %d %d (esperado 0 0 0)\n",
+		r1, r2, r3);
+	cerrar_rwlock(desc);
+	printf("prueba_rwlock: rdlock cerrado: %d (esperado -3)\n",
+		rdlock(desc));
+
+	probar_preferencia(PREFERENCIA_ESCRITORES, "escritores", "EL");
+	probar_preferencia(PREFERENCIA_LECTORES, "lectores", "LE");
+
+	for (es_rw=0; es_rw<=1; es_rw++){
+		desc=es_rw ? crear_rwlock("lect", PREFERENCIA_ESCRITORES) :
+			crear_mutex("lect", NO_RECURSIVO);
+		if (desc<0){
+			printf("prueba_rwlock: error creando lect\n");
+			return 1;
+		}
+		for (g=0; g<sizeof(grupos)/sizeof(grupos[0]); g++){
+			n=grupos[g];
+			ticks=medir(n, &espera);
+			printf("prueba_rwlock: %s, %d lectores (%d procesadores): %lu ticks, %lu lecturas/s, espera media %lu.%02lu ticks/lectura\n",
+				es_rw ? "rwlock" : "mutex", n,
+				pagina_datos()->num_ucps, ticks,
+				ticks>0 ? n*ITERACIONES*TICKS_POR_SEG/ticks : 0,
+				espera/(n*ITERACIONES),
+				espera*100/(n*ITERACIONES)%100);
+		}
+		if (es_rw)
+			cerrar_rwlock(desc);
+		else
+			cerrar_mutex(desc);
+	}
+
+	printf("prueba_rwlock: termina\n");
+	return 0;
+}
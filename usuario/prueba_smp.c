@@ -0,0 +1,34 @@
+/*
+ * usuario/prueba_smp.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que mide cmo escala el sistema con el nmero de
+ * procesadores. Crea varios procesos "mudo", que solo gastan CPU; al
+ * terminar el ltimo, el ncleo muestra el tiempo total y los ticks que
+ * cada procesador ha estado ocupado. Requiere un ncleo compilado con
+ * OPCIONES="-DSMP -DNUM_UCPS=n -DESTADISTICAS" y los programas con "make MISC=fuente"
+ * (el guion prueba_smp.sh lo hace para varios valores de n).
+ */
+
+#include "servicios.h"
+
+#define NUM_MUDOS 8
+
+int main(){
+	int i;
+
+	printf("prueba_smp: comienza\n");
+
+	for (i=0; i<NUM_MUDOS; i++)
+		if (crear_proceso("mudo")<0)
+			printf("Error creando mudo\n");
+
+	printf("prueba_smp: termina\n");
+	return 0;
+}
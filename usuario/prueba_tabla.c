@@ -0,0 +1,44 @@
+/*
+ * usuario/prueba_tabla.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que prueba la tabla de procesos con muchos
+ * procesos. En cada tanda crea NUM_HIJOS procesos "efimero" con la
+ * mxima prioridad, para que todos estn vivos a la vez, y espera a
+ * que terminen. La segunda tanda reutiliza las entradas de la tabla
+ * que ha dejado libres la primera, pero sus identificadores deben ser
+ * todos nuevos.
+ */
+
+#include "servicios.h"
+
+#define NUM_TANDAS 2
+#define NUM_HIJOS 2000	/* ponga los que considere oportuno */
+
+int main(){
+	int ids[NUM_HIJOS];
+	int i, j, tanda;
+
+	printf("prueba_tabla: comienza\n");
+
+	fijar_prioridad(NUM_PRIORIDADES-1);
+
+	for (tanda=0; tanda<NUM_TANDAS; tanda++){
+		for (i=0; i<NUM_HIJOS; i++)
+			if ((ids[i]=crear_proceso("efimero"))<0)
+				break;
+		printf("prueba_tabla: tanda %d, creados %d procesos efimero\n",
+			tanda, i);
+		for (j=0; j<i; j++)
+			esperar_proceso(ids[j], 0);
+	}
+
+	printf("prueba_tabla: termina\n");
+	return 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * usuario/prueba_tabla_mutex.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que mide el coste de las operaciones sobre mutex
+ * segn cuntos tiene abiertos el proceso. Crea mutex hasta que llega al
+ * lmite de los que puede tener abiertos (NUM_MUT_PROC) y mide lock y
+ * unlock sobre el primero, el del medio y el ltimo, y la bsqueda por
+ * nombre. Comprueba adems que el identificador de un mutex destruido
+ * no vale para el que ocupa despus su entrada. Para probar con muchos
+ * mutex, compile el ncleo con p.ej.
+ * make OPCIONES="-DNUM_MUT=1024 -DNUM_MUT_PROC=1024".
+ */
+
+#include "servicios.h"
+
+#define MAX_MUTEX 1024
+#define VECES 1000
+
+static unsigned long leer_ciclos(){
+	return __builtin_ia32_rdtsc();
+}
+
+/* nombre "m<n>" del mutex n */
+static void nombre_mutex(char *nombre, int n){
+	char cifras[8];
+	int i=0, j=0;
+
+	nombre[j++]='m';
+	do {
+		cifras[i++]='0'+n%10;
+		n/=10;
+	} while (n>0);
+	while (i>0)
+		nombre[j++]=cifras[--i];
+	nombre[j]='\0';
+}
+
+/* ciclos de un par lock/unlock sobre el mutex */
+static unsigned long medir_lock(int id){
+	unsigned long ini;
+	int i;
+
+	ini=leer_ciclos();
+	for (i=0; i<VECES; i++){
+		if (lock(id)<0 || unlock(id)<0){
+			printf("prueba_tabla_mutex: error en lock/unlock de %d\n", id);
+			return 0;
+		}
+	}
+	return (leer_ciclos()-ini)/VECES;
+}
+
+/* ciclos de abrir por nombre un mutex que el proceso ya tiene abierto */
+static unsigned long medir_nombre(int n, int id){
+	char nombre[8];
+	unsigned long ini;
+	int i;
+
+	nombre_mutex(nombre, n);
+	ini=leer_ciclos();
+	for (i=0; i<VECES; i++)
+		if (abrir_mutex(nombre)!=id){
+			printf("prueba_tabla_mutex: error abriendo %s\n", nombre);
+			return 0;
+		}
+	return (leer_ciclos()-ini)/VECES;
+}
+
+int main(){
+	static int ids[MAX_MUTEX];
+	char nombre[8];
+	int n, i, id;
+
+	printf("prueba_tabla_mutex: comienza\n");
+
+	for (n=0; n<MAX_MUTEX; n++){
+		nombre_mutex(nombre, n);
+		if ((ids[n]=crear_mutex(nombre, NO_RECURSIVO))<0)
+			break;
+	}
+	printf("prueba_tabla_mutex: %d mutex abiertos\n", n);
+	if (n==0)
+		return 1;
+
+	printf("prueba_tabla_mutex: lock+unlock: primero %lu ciclos, medio %lu, ultimo %lu\n",
+		medir_lock(ids[0]), medir_lock(ids[n/2]), medir_lock(ids[n-1]));
+
+	/* con uno menos, para que abrir no falle por el limite */
+	cerrar_mutex(ids[--n]);
+	if (n>0)
+		printf("prueba_tabla_mutex: abrir por nombre: primero %lu ciclos, ultimo %lu\n",
+			medir_nombre(0, ids[0]), medir_nombre(n-1, ids[n-1]));
+
+	/* el nuevo mutex ocupa la entrada que deja libre el cerrado */
+	if ((id=crear_mutex("nuevo", NO_RECURSIVO))<0)
+		printf("prueba_tabla_mutex: error creando nuevo\n");
+	else if (id==ids[n])
+		printf("prueba_tabla_mutex: ERROR: se reutiliza el identificador %d\n", id);
+	if (lock(ids[n])!=-3)
+		printf("prueba_tabla_mutex: ERROR: lock con el identificador de un mutex cerrado\n");
+	else
+		printf("prueba_tabla_mutex: el identificador de un mutex cerrado no vale\n");
+	cerrar_mutex(id);
+
+	for (i=0; i<n; i++)
+		cerrar_mutex(ids[i]);
+	printf("prueba_tabla_mutex: termina\n");
+	return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * usuario/prueba_tick_dinamico.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que comprueba el tick dinmico: cuenta con la
+ * pgina de datos del ncleo los ticks y las interrupciones de reloj
+ * mientras duerme sin ningn otro proceso listo y mientras calcula.
+ * Con un ncleo compilado con OPCIONES=-DTICK_DINAMICO, dormido debe
+ * haber muchas menos interrupciones que ticks; calculando, una por
+ * tick. Sin l, siempre una por tick.
+ */
+
+#include "servicios.h"
+
+#define SEGS_DORMIDO 2
+#define TICKS_CALCULANDO 100
+
+int main(){
+	const volatile struct datos_nucleo *datos=pagina_datos();
+	unsigned long ticks, ints;
+
+	printf("prueba_tick_dinamico: comienza\n");
+
+	ticks=datos->ticks;
+	ints=datos->ints_reloj;
+	dormir(SEGS_DORMIDO);
+	ticks=datos->ticks-ticks;
+	ints=datos->ints_reloj-ints;
+	printf("prueba_tick_dinamico: dormido: %lu ticks, %lu ints. de reloj\n",
+		ticks, ints);
+	printf("prueba_tick_dinamico: en reposo %s\n", ints*10<ticks ?
+		"se omiten ticks" : "el reloj es periodico");
+
+	ticks=datos->ticks;
+	ints=datos->ints_reloj;
+	while (datos->ticks-ticks<TICKS_CALCULANDO);
+	ticks=datos->ticks-ticks;
+	ints=datos->ints_reloj-ints;
+	printf("prueba_tick_dinamico: calculando: %lu ticks, %lu ints. de reloj\n",
+		ticks, ints);
+
+	printf("prueba_tick_dinamico: termina\n");
+	return 0;
+}
@@ -0,0 +1,23 @@
+/*
+ * usuario/terminador.c
+ *
+ *  Minikernel. Versin 1.0
+ *
+ *  Fernando Prez Costoya
+ *
+ */
+
+/*
+ * Programa de usuario que termina con su identificador como cdigo de
+ * terminacin. Lo usa prueba_esperar.
+ */
+
+#include "servicios.h"
+
+int main(){
+	int id=obtener_id_pr();
+
+	printf("terminador (%d): termina\n", id);
+	terminar_proceso_estado(id);
+	return 0; /* No se debera llegar a este punto */
+}